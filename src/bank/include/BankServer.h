@@ -24,16 +24,32 @@
 #ifndef BANKSERVER_H
 #define BANKSERVER_H
 
+#include <atomic>
 #include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "DepositBatch.h"
+#include "DepositLedger.h"
+#include "DepositRecord.h"
+#include "KeyPool.h"
 #include "MoneyOrder.h"
+#include "MoneyOrderInfo.h"
 #include "NetComm.h"
 #include "Rsa.h"
 
 namespace BankCommands
 {
     const std::string DEPOSIT_MONEY_ORDER  = "DEPOSIT MONEY ORDER";
+    const std::string DEPOSIT_BATCH        = "DEPOSIT BATCH";
     const std::string SIGN_MONEY_ORDER     = "SIGN MONEY ORDER";
+    // withdraws several coins in one session
+    const std::string SIGN_MONEY_ORDERS    = "SIGN MONEY ORDERS";
     const std::string GET_PUBLIC_KEY       = "GET PUBLIC KEY";
+    // the fingerprint of the keys GET PUBLIC KEY would send
+    const std::string GET_KEY_ID           = "GET KEY ID";
     const std::string CLOSE_CONNECTION     = "CLOSE CONNECTION";
     const std::string OPEN_ACCOUNT         = "OPEN ACCOUNT";
 }
@@ -43,10 +59,36 @@ namespace Bank
     class BankServer : public NetComm::Server
     {
         public:
-            BankServer( char* port ) : Server( std::atoi(port) ) 
+            struct Options
             {
-                std::tie(priv, pub) = Rsa::GenerateKeys(256);
-            }
+                // empty, then deposits are only kept in memory.  A bank that rotates
+                // its keys keeps each epoch's deposits in <ledgerFile>.<epoch>.
+                std::string  ledgerFile;
+                // empty, then new key pairs are generated on every start, otherwise
+                // each denomination keeps its key pair in <keyFile>.<denomination>,
+                // or <keyFile>.<epoch>.<denomination> if the bank rotates its keys
+                std::string  keyFile;
+                unsigned int keyBits = 256;
+                // one signing key per denomination, a money order is worth the
+                // denomination whose key signed it
+                std::vector<unsigned int> denominations = { 1, 5, 10, 20, 50, 100 };
+                // cut-and-choose policy for withdrawals: the buyer makes numMoneyOrders
+                // money orders with numIdentStrings identity strings each.  With an
+                // auditProbability of 0 the bank opens every money order but the one it
+                // signs, otherwise it opens just enough that a money order the buyer
+                // cheated on is opened with at least that probability.
+                unsigned int numMoneyOrders   = 100;
+                unsigned int numIdentStrings  = 100;
+                double       auditProbability = 0;
+                // 0, then the bank signs with the same keys forever.  Otherwise it
+                // makes new keys every epochSeconds, and takes deposits of money orders
+                // signed up to acceptEpochs epochs before the current one.  Older money
+                // orders have expired and the bank forgets which of them were spent.
+                unsigned int epochSeconds = 0;
+                unsigned int acceptEpochs = 1;
+            };
+
+            BankServer( char* port, const Options& options );
             ~BankServer() = default;
             void run(tcp::socket sock1);
 
@@ -56,44 +98,102 @@ namespace Bank
                 unsigned int amount   = 0;
             };
 
-            struct DepositInformation
-            {
-                DepositInformation(const std::string& depositorId, 
-                                   const MoneyOrder& moneyOrder,
-                                   const std::string& selectorStr,
-                                   const std::vector<std::string>& ident_strings)
-                    : depositorIdentity(depositorId),
-                      moneyOrder(moneyOrder),
-                      selectorStr(selectorStr),
-                      identity_strings(ident_strings){}
-
-                DepositInformation( const DepositInformation& other )
-                    : depositorIdentity(other.depositorIdentity),
-                      moneyOrder(other.moneyOrder),
-                      selectorStr(other.selectorStr),
-                      identity_strings(other.identity_strings){}
-
-                std::string depositorIdentity = "";
-                MoneyOrder  moneyOrder;
-                std::string selectorStr = "";
-                std::vector<std::string> identity_strings;
-            };
-
         private:
 
             void SignMoneyOrder(tcp::socket& sock1);
+            void SignMoneyOrders(tcp::socket& sock1);
+            // checks that an opened money order is the one that was blinded and that
+            // every identity string in it hides expected_ident
+            bool AuditMoneyOrder(const std::string&    expected_ident,
+                                 const mpz_class&      blinded_hash,
+                                 const MoneyOrderInfo& info,
+                                 const std::string&    money_order,
+                                 const Rsa::PublicKey& pub) const;
             void DepositMoneyOrder(tcp::socket& sock1);
+            void DepositBatch(tcp::socket& sock1);
+            // checks the whole batch against the deposits made so far and records
+            // the new ones with a single ledger write.  Only numbered deposits, those
+            // of DEPOSIT BATCH, can be taken as sent again.
+            std::vector<std::string> ProcessDeposits(const std::string&             identity,
+                                                     const std::vector<::Deposit>&  deposits,
+                                                     const std::vector<MoneyOrder>& moneyOrders,
+                                                     const std::vector<bool>&       valid,
+                                                     const bool                     numbered);
+            void ReportDoubleDeposit(const std::string&   identity,
+                                     const DepositRecord& previous,
+                                     const DepositRecord& deposit);
             void GetPublicKey(tcp::socket& sock1);
+            void GetKeyId(tcp::socket& sock1);
             void OpenAccount(tcp::socket& sock1);
 
+            // epoch, denomination
+            typedef std::pair<unsigned int, unsigned int> KeyId;
+
+            unsigned int CurrentEpoch() const;
+            // moves the bank to the current epoch if it is not there yet: makes the
+            // epoch's keys and drops the keys and deposits of epochs that have expired
+            void Rotate();
+            // loads the epoch's keys, making the missing ones if make_keys, and opens
+            // its deposits.  The caller holds m_key_mutex.
+            void AddEpoch(const unsigned int epoch, const bool make_keys);
+            // drops every epoch before oldest.  The caller holds m_key_mutex.
+            void DropEpochs(const unsigned int oldest);
+            // encodes the keys clients are sent, once per rotation.  The caller holds m_key_mutex.
+            void PublishKeys();
+            std::string KeyFile(const unsigned int epoch, const unsigned int denomination) const;
+            std::string LedgerFile(const unsigned int epoch) const;
+
+            // throws std::invalid_argument unless the bank signs money orders worth
+            // amount in epoch
+            Rsa::KeyPair SigningKey(const unsigned int epoch, const unsigned int amount);
+            // false if the bank holds no such key, or no longer does
+            bool DepositKey(const unsigned int epoch, const unsigned int amount, Rsa::PublicKey& pub);
+
+            const Options m_options;
+
+            // guards m_accounts and m_partitions, connections are served concurrently.
+            // Taken after m_key_mutex by anyone who needs both.
+            std::mutex m_mutex;
+
             // maps  identity string to  account information
             std::map<std::string, BankServer::AccountInformation> m_accounts;
-            
-            // maps  uniqueness string to deposit information
-            std::map<std::string, BankServer::DepositInformation> m_deposits;
 
-            Rsa::PrivateKey priv;
-            Rsa::PublicKey  pub;
+            // the money orders deposited in one epoch, dropped with its keys
+            struct Partition
+            {
+                // maps  coin id to what the bank keeps of the deposit
+                std::unordered_map<CoinId, DepositRecord, CoinId::Hash> deposits;
+                // maps  depositor and deposit number to  the money order deposited under
+                // them, for the deposits that were numbered
+                std::map<std::pair<std::string, uint64_t>, CoinId> sequences;
+                std::unique_ptr<DepositLedger> ledger;
+            };
+
+            // maps  epoch to  its deposits, for every epoch still accepted
+            std::map<unsigned int, Partition> m_partitions;
+
+            // ready key pairs for new keys, so that handing one out never waits on a prime search
+            static const size_t KEY_POOL_SIZE = 2;
+            Rsa::KeyPool m_key_pool;
+
+            // guards m_keys, m_key_set and m_key_id, and m_epoch against concurrent rotations
+            std::mutex m_key_mutex;
+
+            // maps  key id to  signing key, for every epoch still accepted
+            std::map<KeyId, Rsa::KeyPair> m_keys;
+
+            // the epoch new money orders are signed in
+            std::atomic<unsigned int> m_epoch;
+
+            // the serialized PublicKeySet of m_keys, sent as is, and its fingerprint.  A
+            // rotation replaces the set, connections still sending the old one keep it alive.
+            std::shared_ptr<const std::string> m_key_set;
+            std::string                         m_key_id;
+
+            unsigned int m_num_money_orders;
+            unsigned int m_num_ident_strings;
+            // how many money orders the buyer has to open per withdrawal
+            unsigned int m_num_revealed;
     };
 }
 
@@ -0,0 +1,61 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#ifndef DEPOSITLEDGER_H
+#define DEPOSITLEDGER_H
+
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace Bank
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+    //! Append only file of deposit records.  Each Append() is a single write followed
+    //! by a single fsync, however many records it carries.
+    /////////////////////////////////////////////////////////////////////////////////////
+    class DepositLedger
+    {
+        public:
+            DepositLedger( const std::string& filename );
+            ~DepositLedger();
+
+            // every complete record in the ledger, in the order it was appended
+            std::vector<std::string> Load();
+
+            void Append( const std::vector<std::string>& records );
+
+        private:
+            DepositLedger( const DepositLedger& ) = delete;
+            DepositLedger& operator=( const DepositLedger& ) = delete;
+
+            // cuts the ledger back to length bytes, throws std::runtime_error if it cannot
+            void Truncate( const off_t length );
+
+            std::string filename;
+            int         fd;
+    };
+}
+
+#endif // DEPOSITLEDGER_H
@@ -0,0 +1,88 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#ifndef DEPOSITRECORD_H
+#define DEPOSITRECORD_H
+
+#include "CoinId.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Bank
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+    //! What the bank keeps of a deposited money order: enough to spot it being deposited
+    //! again and to tell who cheated when it is.  That is the money order's id, the
+    //! selector the merchant chose and the half of each identity string the buyer
+    //! revealed for it; the rest of the money order is dropped.  The depositor's number
+    //! for the deposit makes a deposit sent again the very same record.  A record is a
+    //! single string of bytes, the same in memory and in the ledger:
+    //!
+    //!     version | id | amount | sequence | count | width | depositor length |
+    //!     selector, one bit per identity string | count shares of width bytes | depositor
+    //!
+    //! Numbers are big endian.  Shares are padded with leading zero bytes to the width
+    //! of the longest, which leaves the numbers they hold unchanged.
+    /////////////////////////////////////////////////////////////////////////////////////
+    class DepositRecord
+    {
+        public:
+            // throws std::invalid_argument unless selector is made of '1's and '2's and
+            // there is one revealed share for each of its characters
+            DepositRecord( const CoinId&                   id,
+                           const std::string&              depositor,
+                           const unsigned int              amount,
+                           const uint64_t                  sequence,
+                           const std::string&              selector,
+                           const std::vector<std::string>& shares );
+
+            // a record from its bytes, throws std::invalid_argument if they are not one
+            static DepositRecord Decode( const std::string& encoded );
+
+            const std::string& Encoded() const { return m_data; }
+
+            CoinId       Id() const;
+            std::string  Depositor() const;
+            unsigned int Amount() const;
+            uint64_t     Sequence() const;
+
+            // the number of identity strings
+            size_t       Size() const;
+
+            // true where the merchant asked for the left half, selector character '1'
+            bool         Left( const size_t i ) const;
+            std::string  Share( const size_t i ) const;
+
+            bool         SameSelector( const DepositRecord& other ) const;
+
+        private:
+            DepositRecord() {}
+
+            std::string m_data;
+    };
+}
+
+#endif // DEPOSITRECORD_H
@@ -23,26 +23,130 @@
 
 #include <cstdlib>
 #include <iostream>
+#include <sstream>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "BankServer.h"
+#include "Log.h"
+#include "MetricsServer.h"
+
+namespace
+{
+    const char* USAGE = "Usage: bank <port> [--ledger <file>] [--key <file>] [--key-bits <n>]"
+                        " [--denominations <n,n,...>] [--money-orders <n>] [--ident-strings <n>]"
+                        " [--audit-probability <p>] [--epoch-seconds <n>] [--accept-epochs <n>]"
+                        " [--metrics-port <n>]\n";
+
+    // limits on the withdrawal policy, the buyer refuses anything larger
+    const int MAX_MONEY_ORDERS  = 4096;
+    const int MAX_IDENT_STRINGS = 4096;
+
+    // "1,5,10" -> 1 5 10, an empty vector if any of them is not a positive number
+    std::vector<unsigned int> ParseDenominations(const std::string& list)
+    {
+        std::vector<unsigned int> denominations;
+
+        std::stringstream in(list);
+        std::string item;
+        while (std::getline(in, item, ','))
+        {
+            int denomination = std::atoi(item.c_str());
+            if (denomination <= 0)
+            {
+                return std::vector<unsigned int>();
+            }
+            denominations.push_back(denomination);
+        }
+
+        return denominations;
+    }
+}
 
 int main(int argc, char* argv[])
 {
     try
     {
-        if (argc != 2)
+        if (argc < 2)
         {
-            std::cerr << "Usage: bank <port>\n";
+            std::cerr << USAGE;
             return 1;
         }
 
-        Bank::BankServer bankServer( argv[1] );
+        Bank::BankServer::Options options;
+        unsigned short metricsPort = 0;
+        for (int i = 2; i < argc; ++i)
+        {
+            std::string option = argv[i];
+            if (option == "--ledger" && i + 1 < argc)
+            {
+                options.ledgerFile = argv[++i];
+            }
+            else if (option == "--key" && i + 1 < argc)
+            {
+                options.keyFile = argv[++i];
+            }
+            else if (option == "--key-bits" && i + 1 < argc && std::atoi(argv[i + 1]) >= 64)
+            {
+                options.keyBits = std::atoi(argv[++i]);
+            }
+            else if (option == "--money-orders" && i + 1 < argc &&
+                     std::atoi(argv[i + 1]) >= 2 && std::atoi(argv[i + 1]) <= MAX_MONEY_ORDERS)
+            {
+                options.numMoneyOrders = std::atoi(argv[++i]);
+            }
+            else if (option == "--ident-strings" && i + 1 < argc &&
+                     std::atoi(argv[i + 1]) >= 1 && std::atoi(argv[i + 1]) <= MAX_IDENT_STRINGS)
+            {
+                options.numIdentStrings = std::atoi(argv[++i]);
+            }
+            else if (option == "--audit-probability" && i + 1 < argc &&
+                     std::atof(argv[i + 1]) >= 0 && std::atof(argv[i + 1]) < 1)
+            {
+                options.auditProbability = std::atof(argv[++i]);
+            }
+            else if (option == "--epoch-seconds" && i + 1 < argc && std::atoi(argv[i + 1]) >= 0)
+            {
+                options.epochSeconds = std::atoi(argv[++i]);
+            }
+            else if (option == "--accept-epochs" && i + 1 < argc && std::atoi(argv[i + 1]) >= 0)
+            {
+                options.acceptEpochs = std::atoi(argv[++i]);
+            }
+            else if (option == "--metrics-port" && i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+            {
+                metricsPort = std::atoi(argv[++i]);
+            }
+            else if (option == "--denominations" && i + 1 < argc)
+            {
+                options.denominations = ParseDenominations(argv[++i]);
+                if (options.denominations.empty())
+                {
+                    std::cerr << USAGE;
+                    return 1;
+                }
+            }
+            else
+            {
+                std::cerr << USAGE;
+                return 1;
+            }
+        }
+
+        Bank::BankServer bankServer( argv[1], options );
+
+        if (metricsPort != 0)
+        {
+            Metrics::StartMetricsServer(metricsPort);
+        }
+
         bankServer.Start();
     }
     catch (std::exception& e)
     {
-        std::cerr << "Exception: " << e.what() << "\n";
+        Log::Error("exception").Field("in", "main()").Field("error", e.what());
+        Log::Flush();
     }
 
     return 0;
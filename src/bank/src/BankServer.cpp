@@ -25,18 +25,193 @@
 #include "BankServer.h"
 
 #include "BlindSignature.h"
+#include "Log.h"
+#include "Metrics.h"
 #include "MoneyOrder.h"
 #include "MoneyOrderInfo.h"
+#include "Parallel.h"
+#include "PublicKeySet.h"
 #include "Random.h"
 #include "Rsa.h"
 #include "SecretSplitting.h"
 #include "Utilities.h"
+#include "WithdrawalBatch.h"
 
-#include <boost/progress.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <ctime>
+#include <set>
+#include <stdexcept>
+
+#include <dirent.h>
+#include <unistd.h>
 
 namespace
 {
     const unsigned int BASE = 10;
+
+    // the most coins one SIGN MONEY ORDERS session may withdraw
+    const unsigned int MAX_WITHDRAWAL_COINS = 1000;
+
+    // from reading the command to answering it, by command
+    Metrics::Histogram& CommandLatency(const std::string& command)
+    {
+        static const std::map<std::string, Metrics::Histogram*> histograms = []
+        {
+            const std::string HELP = "Time the bank takes to serve a command";
+
+            std::map<std::string, Metrics::Histogram*> commands;
+            commands[BankCommands::DEPOSIT_MONEY_ORDER] = &Metrics::GetHistogram("bank_command_seconds{command=\"deposit_money_order\"}", HELP);
+            commands[BankCommands::DEPOSIT_BATCH]       = &Metrics::GetHistogram("bank_command_seconds{command=\"deposit_batch\"}", HELP);
+            commands[BankCommands::SIGN_MONEY_ORDER]    = &Metrics::GetHistogram("bank_command_seconds{command=\"sign_money_order\"}", HELP);
+            commands[BankCommands::SIGN_MONEY_ORDERS]   = &Metrics::GetHistogram("bank_command_seconds{command=\"sign_money_orders\"}", HELP);
+            commands[BankCommands::GET_PUBLIC_KEY]      = &Metrics::GetHistogram("bank_command_seconds{command=\"get_public_key\"}", HELP);
+            commands[BankCommands::GET_KEY_ID]          = &Metrics::GetHistogram("bank_command_seconds{command=\"get_key_id\"}", HELP);
+            commands[BankCommands::OPEN_ACCOUNT]        = &Metrics::GetHistogram("bank_command_seconds{command=\"open_account\"}", HELP);
+            commands[""]                                = &Metrics::GetHistogram("bank_command_seconds{command=\"unknown\"}", HELP);
+            return commands;
+        }();
+
+        auto it = histograms.find(command);
+        return (it != histograms.end()) ? *it->second : *histograms.at("");
+    }
+
+    const std::string CRYPTO_HELP = "Time taken by one cryptographic operation";
+
+    // verify covers checking one money order's bit commitments, which is mostly hashing
+    Metrics::Histogram& sign_latency             = Metrics::GetHistogram("crypto_seconds{op=\"sign\"}", CRYPTO_HELP);
+    Metrics::Histogram& check_blinding_latency   = Metrics::GetHistogram("crypto_seconds{op=\"check_blinding\"}", CRYPTO_HELP);
+    Metrics::Histogram& verify_signature_latency = Metrics::GetHistogram("crypto_seconds{op=\"verify_signature\"}", CRYPTO_HELP);
+    Metrics::Histogram& verify_batch_latency     = Metrics::GetHistogram("crypto_seconds{op=\"verify_signature_batch\"}", CRYPTO_HELP);
+    Metrics::Histogram& verify_latency           = Metrics::GetHistogram("crypto_seconds{op=\"verify\"}", CRYPTO_HELP);
+
+    const std::string WITHDRAWAL_HELP = "Withdrawals by outcome";
+    Metrics::Counter& withdrawals_signed  = Metrics::GetCounter("bank_withdrawals_total{result=\"signed\"}", WITHDRAWAL_HELP);
+    Metrics::Counter& withdrawals_refused = Metrics::GetCounter("bank_withdrawals_total{result=\"refused\"}", WITHDRAWAL_HELP);
+
+    Metrics::Counter& money_orders_received = Metrics::GetCounter("bank_money_orders_received_total", "Blinded money orders received for signing");
+    Metrics::Counter& money_orders_audited  = Metrics::GetCounter("bank_money_orders_audited_total", "Money orders the bank opened and checked");
+
+    const std::string DEPOSIT_HELP = "Deposits by outcome";
+    Metrics::Counter& deposits_accepted = Metrics::GetCounter("bank_deposits_total{result=\"accepted\"}", DEPOSIT_HELP);
+    Metrics::Counter& deposits_double   = Metrics::GetCounter("bank_deposits_total{result=\"double\"}", DEPOSIT_HELP);
+    Metrics::Counter& deposits_invalid  = Metrics::GetCounter("bank_deposits_total{result=\"invalid\"}", DEPOSIT_HELP);
+    Metrics::Counter& deposits_expired  = Metrics::GetCounter("bank_deposits_total{result=\"expired\"}", DEPOSIT_HELP);
+
+    // unlinks the files <base>.<epoch> (or <base>.<epoch>.<denomination> if
+    // with_denomination) of epochs before oldest, left behind by a bank that was
+    // stopped while they expired
+    void SweepExpiredFiles(const std::string& base, const bool with_denomination, const unsigned int oldest)
+    {
+        const std::string::size_type slash = base.rfind('/');
+        const std::string directory = (slash == std::string::npos) ? "." : base.substr(0, slash + 1);
+        const std::string prefix    = ((slash == std::string::npos) ? base : base.substr(slash + 1)) + ".";
+
+        DIR* dir = opendir(directory.c_str());
+        if (dir == NULL)
+        {
+            return;
+        }
+
+        std::vector<std::string> expired;
+        while (struct dirent* entry = readdir(dir))
+        {
+            const std::string name = entry->d_name;
+            if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+                !std::isdigit(static_cast<unsigned char>(name[prefix.size()])))
+            {
+                continue;
+            }
+
+            char* end = NULL;
+            const unsigned long epoch = std::strtoul(name.c_str() + prefix.size(), &end, BASE);
+            if (with_denomination)
+            {
+                if (*end != '.' || !std::isdigit(static_cast<unsigned char>(end[1])))
+                {
+                    continue;
+                }
+                std::strtoul(end + 1, &end, BASE);
+            }
+
+            if (*end == '\0' && epoch < oldest)
+            {
+                expired.push_back(name);
+            }
+        }
+        closedir(dir);
+
+        for (const auto& name : expired)
+        {
+            const std::string filename = (slash == std::string::npos) ? name : directory + name;
+            if (unlink(filename.c_str()) == 0)
+            {
+                Log::Info("removed expired file").Field("file", filename);
+            }
+        }
+    }
+}
+
+const size_t Bank::BankServer::KEY_POOL_SIZE;
+
+Bank::BankServer::BankServer( char* port, const Options& options )
+    : Server( std::atoi(port) ),
+      m_options( options ),
+      // a rotating bank takes a whole set of keys at once, and the pool refills over the epoch
+      m_key_pool( options.keyBits, options.epochSeconds ? std::max(KEY_POOL_SIZE, options.denominations.size())
+                                                        : KEY_POOL_SIZE ),
+      m_epoch( 0 ),
+      m_num_money_orders( options.numMoneyOrders ),
+      m_num_ident_strings( options.numIdentStrings ),
+      m_num_revealed( options.numMoneyOrders - 1 )
+{
+    if (options.auditProbability > 0)
+    {
+        // a cheating buyer's bad money order is one of numMoneyOrders, so it is
+        // opened with probability revealed/numMoneyOrders
+        unsigned int revealed = std::ceil(options.auditProbability * m_num_money_orders);
+        m_num_revealed = std::max(1u, std::min(revealed, m_num_revealed));
+    }
+
+    Log::Info("withdrawal policy").Field("revealed", m_num_revealed)
+                                  .Field("money_orders", m_num_money_orders)
+                                  .Field("ident_strings", m_num_ident_strings);
+
+    // the epochs still accepted come back from their files, only the current one gets
+    // new keys: nothing can have been signed with keys that were never saved
+    std::lock_guard<std::mutex> key_lock(m_key_mutex);
+
+    const unsigned int current = CurrentEpoch();
+    const unsigned int oldest  = (current > options.acceptEpochs) ? current - options.acceptEpochs : 0;
+    for (unsigned int epoch = oldest; epoch < current; ++epoch)
+    {
+        AddEpoch(epoch, false);
+    }
+    AddEpoch(current, true);
+    m_epoch = current;
+    PublishKeys();
+
+    // DropEpochs only sees the epochs the bank held, those that expired while it was
+    // down still have their files
+    if (options.epochSeconds)
+    {
+        if (!options.keyFile.empty())
+        {
+            SweepExpiredFiles(options.keyFile, true, oldest);
+        }
+        if (!options.ledgerFile.empty())
+        {
+            SweepExpiredFiles(options.ledgerFile, false, oldest);
+        }
+    }
+
+    if (options.epochSeconds)
+    {
+        Log::Info("key rotation").Field("epoch", current)
+                                 .Field("epoch_seconds", options.epochSeconds)
+                                 .Field("accept_epochs", options.acceptEpochs);
+    }
 }
 
 void Bank::BankServer::run(tcp::socket sock1)
@@ -47,145 +222,331 @@ void Bank::BankServer::run(tcp::socket sock1)
         {
             // Read Command Decide Path Forward
             std::string cmd = ReadAndAcknowledge(sock1);
+            if (cmd == BankCommands::CLOSE_CONNECTION)
+            {
+                break;
+            }
+
+            Metrics::ScopedTimer timer( CommandLatency(cmd) );
+
+            // the first command of a new epoch rotates the keys
+            Rotate();
 
             if (cmd == BankCommands::DEPOSIT_MONEY_ORDER)
             {
                 DepositMoneyOrder(sock1);
             }
+            else if (cmd == BankCommands::DEPOSIT_BATCH)
+            {
+                DepositBatch(sock1);
+            }
             else if (cmd == BankCommands::SIGN_MONEY_ORDER)
             {
                 SignMoneyOrder(sock1);
             }
+            else if (cmd == BankCommands::SIGN_MONEY_ORDERS)
+            {
+                SignMoneyOrders(sock1);
+            }
             else if (cmd == BankCommands::GET_PUBLIC_KEY)
             {
                 GetPublicKey(sock1);
             }
-            else if (cmd == BankCommands::OPEN_ACCOUNT)
+            else if (cmd == BankCommands::GET_KEY_ID)
             {
-                OpenAccount(sock1);
+                GetKeyId(sock1);
             }
-            else if (cmd == BankCommands::CLOSE_CONNECTION)
+            else if (cmd == BankCommands::OPEN_ACCOUNT)
             {
-                break;
+                OpenAccount(sock1);
             }
             else
             {
-                std::cerr << "Unknown command: " << cmd << std::endl;
+                Log::Warning("unknown command").Field("command", cmd);
             }
         }
     }
     catch (std::exception& e)
     {
-        std::cerr << "Exception in Bank::BankServer::run(): " << e.what() << "\n";
+        Log::Error("exception").Field("in", "Bank::BankServer::run()").Field("error", e.what());
     }
 }
 
 void Bank::BankServer::SignMoneyOrder(tcp::socket& sock1)
 {
+    //////////////////////////////////////////////////////////////////////////////////////////
+    // Read identity string, amount and epoch, the amount and epoch pick the signing key.
+    // A withdrawal the bank has no key for ends the connection.
+    std::string expected_ident = ReadAndAcknowledge(sock1);
+    unsigned int amount = std::atoi(ReadAndAcknowledge(sock1).c_str());
+    unsigned int epoch  = std::strtoul(ReadAndAcknowledge(sock1).c_str(), NULL, BASE);
+    const Rsa::KeyPair keys = SigningKey(epoch, amount);
+
     try
     {
         //////////////////////////////////////////////////////////////////////////////////////////
-        // Read identity string and amount
-        std::string expected_ident = ReadAndAcknowledge(sock1);
-        unsigned int expected_amount = std::atoi(ReadAndAcknowledge(sock1).c_str());
+        // Tell the buyer how many money orders to make, and how many identity strings each
+        const unsigned int num_money_orders  = m_num_money_orders;
+        const unsigned int num_ident_strings = m_num_ident_strings;
+        WriteAndWaitForAcknowledge(sock1, std::to_string(num_money_orders));
+        WriteAndWaitForAcknowledge(sock1, std::to_string(num_ident_strings));
 
         //////////////////////////////////////////////////////////////////////////////////////////
-        // Check how many money orders to expect
-        unsigned int num_money_orders = atoi(ReadAndAcknowledge(sock1).c_str());
-
-        //////////////////////////////////////////////////////////////////////////////////////////
-        // Receive Money Orders
+        // Receive Money Orders, each is the blinded full domain hash of a serialized MoneyOrder
         std::vector<mpz_class> money_orders;
-        std::cout << "Receiving " << num_money_orders << " money orders ... " << std::endl;
-        boost::progress_display show_money_order_progress( num_money_orders );
         for (unsigned int i = 0; i < num_money_orders; ++i)
         {
             std::string money_order = ReadAndAcknowledge(sock1);
            
             money_orders.push_back((mpz_class(money_order, BASE)));
-            ++show_money_order_progress;
         }
+        money_orders_received.Increment(num_money_orders);
 
         //////////////////////////////////////////////////////////////////////////////////////////
-        // Choose random number to not verify
-        mpz_class ran = Random::GenerateRandomNumberRange(num_money_orders) - 1;
-        unsigned int r = std::atoi(ran.get_str(BASE).c_str());
-        WriteAndWaitForAcknowledge(sock1, ran.get_str(BASE));
+        // Choose the money order to sign and the ones the buyer has to open.  The selection
+        // has one character per money order: 'S' sign, 'R' reveal, '-' neither.
+        std::vector<unsigned int> chosen = Random::Sample(num_money_orders, 1 + m_num_revealed);
+        unsigned int r = chosen[0];
+
+        std::string selection(num_money_orders, '-');
+        selection[r] = 'S';
+        for (unsigned int i = 1; i < chosen.size(); ++i)
+        {
+            selection[chosen[i]] = 'R';
+        }
+        WriteAndWaitForAcknowledge(sock1, selection);
 
         //////////////////////////////////////////////////////////////////////////////////////////
-        // Receive Money Order Info
-        std::vector<MoneyOrderInfo> money_orders_info;
+        // Receive Money Order Info and the money order itself for the revealed money orders,
+        // in order
+        std::vector<MoneyOrderInfo> money_orders_info(num_money_orders);
+        std::vector<std::string>    money_orders_serial(num_money_orders);
         for (unsigned int i = 0; i < num_money_orders; ++i)
         {
-            if (i == r)
-            {
-                // empty info
-                MoneyOrderInfo info;
-                money_orders_info.push_back(info);
-            }
-            else
+            if (selection[i] == 'R')
             {
-                MoneyOrderInfo info;
-                std::string money_order_info = ReadAndAcknowledge(sock1);
-                info.Deserialize(money_order_info);
-                money_orders_info.push_back(info);
+                money_orders_info[i].Deserialize(ReadFramedAndAcknowledge(sock1));
+                money_orders_serial[i] = ReadFramedAndAcknowledge(sock1);
             }
         }
 
         bool all_verified = true;
-        std::cout << "Verifying " << num_money_orders-1 << " money orders ..." << std::endl;
-        boost::progress_display show_verification_progress( num_money_orders-1 );
         for (unsigned int i = 0; i < num_money_orders; ++i)
         {
-            // if this is not the money order to sign
-            if (i != r)
+            // only the revealed money orders are checked
+            if (selection[i] == 'R')
             {
-                mpz_class signed_blinded_text = Rsa::Sign(money_orders[i], priv, pub, false);
-                mpz_class unblinded_signed_text = BlindSignature::Unblind(signed_blinded_text, pub, (mpz_class(money_orders_info[i].m_blinding_factor, BASE)), false);
-                mpz_class unsigned_text = Rsa::Unsign(unblinded_signed_text, pub, true);
+                all_verified &= AuditMoneyOrder(expected_ident, money_orders[i], money_orders_info[i], money_orders_serial[i], keys.pub);
+            }
+        }
 
-                MoneyOrder mo;
-                std::string nts = Utilities::NumberToString(unsigned_text);
-                mo.Deserialize(nts);
+        // a single block is signed, anything outside [0, N) is not a blinded hash
+        all_verified &= (money_orders[r] >= 0 && money_orders[r] < keys.pub.N);
 
-                unsigned int j = 0;
-                bool verified = true;
+        // if they have all been verified then sign the one that is still blinded
+        if (all_verified)
+        {
+            mpz_class signed_blinded_text;
+            {
+                Metrics::ScopedTimer timer(sign_latency);
+                signed_blinded_text = Rsa::Sign(money_orders[r], keys, false);
+            }
+
+            // send it back to the buyer
+            WriteAndWaitForAcknowledge(sock1, signed_blinded_text.get_str(BASE));
+            withdrawals_signed.Increment();
+        }
+        else
+        {
+            withdrawals_refused.Increment();
+        }
+    }
+    catch (std::exception& e)
+    {
+        Log::Error("exception").Field("in", "Bank::BankServer::SignMoneyOrder()").Field("error", e.what());
+    }
+}
 
-                verified &= (mo.m_amount == expected_amount);
+void Bank::BankServer::SignMoneyOrders(tcp::socket& sock1)
+{
+    //////////////////////////////////////////////////////////////////////////////////////////
+    // Read identity string, amount, epoch and how many coins to withdraw.  A withdrawal
+    // the bank has no key for ends the connection.
+    std::string expected_ident = ReadAndAcknowledge(sock1);
+    unsigned int amount = std::atoi(ReadAndAcknowledge(sock1).c_str());
+    unsigned int epoch  = std::strtoul(ReadAndAcknowledge(sock1).c_str(), NULL, BASE);
+    unsigned int num_coins = std::atoi(ReadAndAcknowledge(sock1).c_str());
+    const Rsa::KeyPair keys = SigningKey(epoch, amount);
 
-                for (const auto& cd : money_orders_info[i].m_commit_data)
-                {
-                    // verify left side
-                    verified &= Verify(cd.first, mo.m_identity_strings[j].first.first,
-                                                 mo.m_identity_strings[j].first.second);
+    if (num_coins == 0 || num_coins > MAX_WITHDRAWAL_COINS)
+    {
+        throw std::invalid_argument("Cannot withdraw " + std::to_string(num_coins) + " coins at once");
+    }
 
-                    // verify left side
-                    verified &= Verify(cd.second, mo.m_identity_strings[j].second.first,
-                                                  mo.m_identity_strings[j].second.second);
+    try
+    {
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // Tell the buyer how many money orders to make per coin, and how many identity strings each
+        const unsigned int num_money_orders  = m_num_money_orders;
+        const unsigned int num_ident_strings = m_num_ident_strings;
+        WriteAndWaitForAcknowledge(sock1, std::to_string(num_money_orders));
+        WriteAndWaitForAcknowledge(sock1, std::to_string(num_ident_strings));
 
-                    verified &= (expected_ident == SecretSplitting::GetSecret(Utilities::StringToNumber(cd.first.b), Utilities::StringToNumber(cd.second.b)));
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // Receive every coin's money orders in one message
+        const size_t num_total = static_cast<size_t>(num_coins) * num_money_orders;
 
-                    ++j;
-                }
+        BlindedMoneyOrders blinded;
+        blinded.Deserialize(ReadFramedAndAcknowledge(sock1));
+        if (blinded.m_money_orders.size() != num_total)
+        {
+            throw std::invalid_argument("Expected " + std::to_string(num_total) + " money orders");
+        }
 
-                ++show_verification_progress;
+        std::vector<mpz_class> money_orders(num_total);
+        for (size_t i = 0; i < num_total; ++i)
+        {
+            money_orders[i] = mpz_class(blinded.m_money_orders[i], BASE);
+        }
+        money_orders_received.Increment(num_total);
 
-                all_verified &= verified;
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // Choose, for every coin, the money order to sign and the ones to open
+        std::string selection(num_total, '-');
+        std::vector<size_t> signed_indices;
+        std::vector<size_t> revealed_indices;
+        for (size_t k = 0; k < num_coins; ++k)
+        {
+            std::vector<unsigned int> chosen = Random::Sample(num_money_orders, 1 + m_num_revealed);
+
+            signed_indices.push_back(k*num_money_orders + chosen[0]);
+            selection[signed_indices.back()] = 'S';
+            for (unsigned int i = 1; i < chosen.size(); ++i)
+            {
+                selection[k*num_money_orders + chosen[i]] = 'R';
             }
         }
+        for (size_t i = 0; i < num_total; ++i)
+        {
+            if (selection[i] == 'R')
+            {
+                revealed_indices.push_back(i);
+            }
+        }
+        WriteFramedAndWaitForAcknowledge(sock1, selection);
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // Receive the opened money orders, in order, and audit all of them at once
+        OpenedMoneyOrders opened;
+        opened.Deserialize(ReadFramedAndAcknowledge(sock1));
+
+        bool all_verified = (opened.m_info.size() == revealed_indices.size()) &&
+                            (opened.m_money_orders.size() == revealed_indices.size());
 
-        // if they have all been verified then sign the one that is still blinded
         if (all_verified)
         {
-            mpz_class signed_blinded_text = Rsa::Sign(money_orders[r], priv, pub, false);
+            std::vector<char> verified(revealed_indices.size());
+            Parallel::For(revealed_indices.size(), [&](size_t j)
+            {
+                MoneyOrderInfo info;
+                info.Deserialize(opened.m_info[j]);
+                verified[j] = AuditMoneyOrder(expected_ident, money_orders[revealed_indices[j]], info, opened.m_money_orders[j], keys.pub);
+            });
 
-            // send it back to the buyer
-            WriteAndWaitForAcknowledge(sock1, signed_blinded_text.get_str(BASE));
+            all_verified = std::all_of(verified.begin(), verified.end(), [](char v) { return v != 0; });
         }
+
+        // single blocks are signed, anything outside [0, N) is not a blinded hash
+        for (const auto i : signed_indices)
+        {
+            all_verified &= (money_orders[i] >= 0 && money_orders[i] < keys.pub.N);
+        }
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // Sign every coin's remaining money order, or none of them
+        SignedMoneyOrders signatures;
+        if (all_verified)
+        {
+            signatures.m_signatures.resize(num_coins);
+            Parallel::For(num_coins, [&](size_t k)
+            {
+                Metrics::ScopedTimer timer(sign_latency);
+                signatures.m_signatures[k] = Rsa::Sign(money_orders[signed_indices[k]], keys, false).get_str(BASE);
+            });
+
+            withdrawals_signed.Increment();
+        }
+        else
+        {
+            withdrawals_refused.Increment();
+        }
+
+        // an empty answer tells the buyer the withdrawal was refused
+        WriteFramedAndWaitForAcknowledge(sock1, signatures.Serialize());
     }
     catch (std::exception& e)
     {
-        std::cerr << "Exception in Bank::BankServer::SignMoneyOrder: " << e.what() << "\n";
+        Log::Error("exception").Field("in", "Bank::BankServer::SignMoneyOrders()").Field("error", e.what());
+    }
+}
+
+bool Bank::BankServer::AuditMoneyOrder(const std::string&    expected_ident,
+                                       const mpz_class&      blinded_hash,
+                                       const MoneyOrderInfo& info,
+                                       const std::string&    money_order,
+                                       const Rsa::PublicKey& pub) const
+{
+    try
+    {
+        // the blinded number has to be the hash of the opened money order, which
+        // takes the public exponent only
+        bool blinded;
+        {
+            Metrics::ScopedTimer timer(check_blinding_latency);
+            blinded = BlindSignature::VerifyBlinding(blinded_hash,
+                                                     Rsa::FullDomainHash(money_order, pub),
+                                                     pub,
+                                                     mpz_class(info.m_blinding_factor, BASE));
+        }
+
+        MoneyOrder mo;
+        mo.Deserialize(money_order);
+
+        Metrics::ScopedTimer timer(verify_latency);
+
+        unsigned int j = 0;
+        bool verified = blinded &&
+                        (mo.m_identity_strings.size() == m_num_ident_strings) &&
+                        (info.m_commit_data.size() == m_num_ident_strings);
+
+        for (const auto& cd : info.m_commit_data)
+        {
+            if (!verified)
+            {
+                break;
+            }
+
+            // verify left side
+            verified &= Verify(cd.first, mo.m_identity_strings[j].first.first,
+                                         mo.m_identity_strings[j].first.second);
+
+            // verify right side
+            verified &= Verify(cd.second, mo.m_identity_strings[j].second.first,
+                                          mo.m_identity_strings[j].second.second);
+
+            verified &= (expected_ident == SecretSplitting::GetSecret(Utilities::StringToNumber(cd.first.b), Utilities::StringToNumber(cd.second.b)));
+
+            ++j;
+        }
+
+        money_orders_audited.Increment();
+
+        return verified;
+    }
+    catch (std::exception& e)
+    {
+        // a money order that does not even parse is not one the buyer made honestly
+        return false;
     }
 }
 
@@ -193,61 +554,389 @@ void Bank::BankServer::DepositMoneyOrder(tcp::socket& sock1)
 {
     std::string identity = ReadAndAcknowledge(sock1);
 
-    std::string BuyersMoneyOrderStr = ReadAndAcknowledge(sock1);
-    mpz_class BuyersMoneyOrder(BuyersMoneyOrderStr);
-    mpz_class UnsignedBuyersMoneyOrder = Rsa::Unsign( BuyersMoneyOrder, pub, true );
+    std::vector<::Deposit> deposits(1);
+    deposits[0].m_coin.Deserialize( ReadFramedAndAcknowledge(sock1) );
+    const Coin& coin = deposits[0].m_coin;
+
+    std::vector<MoneyOrder> moneyOrders(1);
+    moneyOrders[0].Deserialize( coin.m_money_order );
+
+    deposits[0].m_selector = ReadAndAcknowledge(sock1);
+
+    for(unsigned int i = 0; i < moneyOrders[0].m_identity_strings.size(); ++i)
+    {
+        deposits[0].m_commit_data.push_back(ReadAndAcknowledge(sock1));
+    }
+
+    std::vector<bool> valid(1);
+    Rsa::PublicKey pub;
+    if (DepositKey(coin.m_epoch, coin.m_amount, pub))
+    {
+        Metrics::ScopedTimer timer(verify_signature_latency);
+        valid[0] = Rsa::VerifyFullDomainHash( coin.m_money_order, mpz_class(coin.m_signature, BASE), pub );
+    }
+
+    // a money order deposited twice this way is always a double deposit: these
+    // deposits are not numbered, so none is ever taken as sent again
+    WriteAndWaitForAcknowledge(sock1, ProcessDeposits(identity, deposits, moneyOrders, valid, false)[0]);
+}
+
+void Bank::BankServer::DepositBatch(tcp::socket& sock1)
+{
+    try
+    {
+        ::DepositBatch batch;
+        batch.Deserialize( ReadFramedAndAcknowledge(sock1) );
+
+        const size_t num_deposits = batch.m_deposits.size();
+        std::vector<bool> valid(num_deposits, true);
+
+        // group the coins by epoch and denomination, each group is checked with its own key
+        std::map<KeyId, std::vector<size_t>> denominations;
+        std::vector<mpz_class> signatures(num_deposits);
+        for (size_t i = 0; i < num_deposits; ++i)
+        {
+            try
+            {
+                signatures[i] = mpz_class(batch.m_deposits[i].m_coin.m_signature, BASE);
+                const Coin& coin = batch.m_deposits[i].m_coin;
+                denominations[KeyId(coin.m_epoch, coin.m_amount)].push_back(i);
+            }
+            catch (std::exception& e)
+            {
+                valid[i] = false;
+            }
+        }
+
+        // screen every coin of a key at once, with one exponentiation.  Plain
+        // screening is enough here: a batch that passes only holds money orders the bank
+        // signed, and it is the money orders that get recorded.
+        for (const auto& denomination : denominations)
+        {
+            const std::vector<size_t>& indices = denomination.second;
+
+            Rsa::PublicKey pub;
+            if (!DepositKey(denomination.first.first, denomination.first.second, pub))
+            {
+                for (const auto i : indices)
+                {
+                    valid[i] = false;
+                }
+                continue;
+            }
+
+            std::vector<std::string> message_group;
+            std::vector<mpz_class>   signature_group;
+            for (const auto i : indices)
+            {
+                message_group.push_back(batch.m_deposits[i].m_coin.m_money_order);
+                signature_group.push_back(signatures[i]);
+            }
+
+            std::vector<bool> verified_group;
+            {
+                Metrics::ScopedTimer timer(verify_batch_latency);
+                verified_group = Rsa::BatchVerifyFullDomainHash(message_group, signature_group, pub);
+            }
+            for (size_t j = 0; j < indices.size(); ++j)
+            {
+                valid[indices[j]] = verified_group[j];
+            }
+        }
+
+        std::vector<MoneyOrder> moneyOrders(num_deposits);
+        for (size_t i = 0; i < num_deposits; ++i)
+        {
+            if (!valid[i])
+            {
+                continue;
+            }
 
-    MoneyOrder moneyOrder;
-    moneyOrder.Deserialize( Utilities::NumberToString( UnsignedBuyersMoneyOrder ) );
+            try
+            {
+                moneyOrders[i].Deserialize( batch.m_deposits[i].m_coin.m_money_order );
+
+                // every identity string needs its revealed half
+                valid[i] = (moneyOrders[i].m_identity_strings.size() == batch.m_deposits[i].m_commit_data.size());
+            }
+            catch (std::exception& e)
+            {
+                valid[i] = false;
+            }
+        }
 
-    std::string selectorStr = ReadAndAcknowledge(sock1);
+        DepositReceipt receipt;
+        receipt.m_results = ProcessDeposits(batch.m_depositor, batch.m_deposits, moneyOrders, valid, true);
 
-    std::vector<std::string> commitDataStrVector;
-    for(unsigned int i = 0; i < moneyOrder.m_identity_strings.size(); ++i)
+        WriteFramedAndWaitForAcknowledge(sock1, receipt.Serialize());
+    }
+    catch (std::exception& e)
     {
-        commitDataStrVector.push_back(ReadAndAcknowledge(sock1));
+        Log::Error("exception").Field("in", "Bank::BankServer::DepositBatch()").Field("error", e.what());
+
+        // the merchant is waiting for a receipt; ending the connection tells it the
+        // batch was not taken, and it sends the batch again later
+        throw;
     }
+}
 
-    // check the database to determine whether this money order has already been deposited
-    auto it = m_deposits.find(moneyOrder.m_uniqueness);
-    if (it == m_deposits.end())
+std::vector<std::string> Bank::BankServer::ProcessDeposits(const std::string&             identity,
+                                                           const std::vector<::Deposit>&  deposits,
+                                                           const std::vector<MoneyOrder>& moneyOrders,
+                                                           const std::vector<bool>&       valid,
+                                                           const bool                     numbered)
+{
+    std::vector<std::string> results(deposits.size());
+
+    // what is kept of each deposit, made before taking the lock: the coin id and the
+    // revealed half of every identity string
+    std::vector<std::unique_ptr<DepositRecord>> records(deposits.size());
+    for (size_t i = 0; i < deposits.size(); ++i)
     {
-        DepositInformation depositInfo( identity, moneyOrder, selectorStr, commitDataStrVector );
-        m_deposits.insert( std::pair<std::string, DepositInformation>( moneyOrder.m_uniqueness, depositInfo ));
+        if (!valid[i])
+        {
+            continue;
+        }
+
+        try
+        {
+            std::vector<std::string> shares(deposits[i].m_commit_data.size());
+            for (size_t j = 0; j < shares.size(); ++j)
+            {
+                CommitData data;
+                data.Deserialize(deposits[i].m_commit_data[j]);
+                shares[j] = data.b;
+            }
 
-        WriteAndWaitForAcknowledge(sock1, "Deposit Successful!");
+            records[i].reset( new DepositRecord( moneyOrders[i].m_uniqueness,
+                                                 identity,
+                                                 deposits[i].m_coin.m_amount,
+                                                 deposits[i].m_sequence,
+                                                 deposits[i].m_selector,
+                                                 shares ));
+        }
+        catch (std::exception& e)
+        {
+            // a selector or revealed half the bank cannot keep
+        }
     }
-    else
+
+    // deposits accepted from this batch by epoch, and where to find them by coin id
+    std::vector<std::pair<unsigned int, const DepositRecord*>>                newDeposits;
+    std::map<unsigned int, std::unordered_map<CoinId, size_t, CoinId::Hash>> newDepositIndex;
+
+    // deposit numbers used in this batch, and where to find their deposits
+    std::map<uint64_t, size_t> newSequences;
+
+    // double deposits as (previous, deposit), reported once the batch is recorded
+    std::vector<std::pair<const DepositRecord*, const DepositRecord*>> doubleDeposits;
+    // deposits whose number the depositor had already used for another deposit
+    std::vector<const DepositRecord*> reusedSequences;
+    size_t numExpired = 0;
+    size_t numInvalid = 0;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (size_t i = 0; i < deposits.size(); ++i)
     {
-        std::cout << "Deposit Unsuccesful.  Determining the perpetrator..." << std::endl;
+        const unsigned int epoch = deposits[i].m_coin.m_epoch;
+        auto partition = m_partitions.find(epoch);
 
-        // if the selector string match, then the merchant cheated
-        if (selectorStr == it->second.selectorStr)
+        // the bank keeps the deposits of every epoch it still takes, and no others
+        if (partition == m_partitions.end() && epoch < m_partitions.begin()->first)
         {
-            std::cout << "The merchant, " << identity << ", cheated!" << std::endl;
+            results[i] = "Money Order Expired!";
+            ++numExpired;
+            continue;
+        }
+
+        if (!records[i] || partition == m_partitions.end())
+        {
+            results[i] = "Invalid Money Order!";
+            ++numInvalid;
+            continue;
+        }
+
+        const CoinId   id       = records[i]->Id();
+        const uint64_t sequence = records[i]->Sequence();
+
+        // the depositor numbers each deposit it sends with DEPOSIT BATCH once, so a
+        // number it used before is either a batch sent again after its receipt was
+        // lost, and the very same deposit, or a number reused for another deposit
+        if (numbered && sequence != 0)
+        {
+            const DepositRecord* sent = NULL;
+            bool used = false;
+
+            auto st = newSequences.find(sequence);
+            if (st != newSequences.end())
+            {
+                used = true;
+                if (newDeposits[st->second].first == epoch)
+                {
+                    sent = newDeposits[st->second].second;
+                }
+            }
+            else
+            {
+                for (const auto& other : m_partitions)
+                {
+                    auto jt = other.second.sequences.find(std::make_pair(identity, sequence));
+                    if (jt != other.second.sequences.end())
+                    {
+                        used = true;
+                        if (other.first == epoch)
+                        {
+                            sent = &other.second.deposits.at(jt->second);
+                        }
+                        break;
+                    }
+                }
+            }
+
+            if (used)
+            {
+                if (sent != NULL && sent->Encoded() == records[i]->Encoded())
+                {
+                    // the deposit already stands
+                    results[i] = "Deposit Successful!";
+                }
+                else
+                {
+                    reusedSequences.push_back(records[i].get());
+                    results[i] = "Deposit Number Reused!";
+                    ++numInvalid;
+                }
+                continue;
+            }
+        }
+
+        // check the epoch's deposits, and the rest of this batch, to determine whether
+        // this money order has already been deposited
+        const DepositRecord* previous = NULL;
+        auto it = partition->second.deposits.find(id);
+        if (it != partition->second.deposits.end())
+        {
+            previous = &it->second;
+        }
+        else
+        {
+            auto jt = newDepositIndex[epoch].find(id);
+            if (jt != newDepositIndex[epoch].end())
+            {
+                previous = newDeposits[jt->second].second;
+            }
+        }
+
+        if (previous == NULL)
+        {
+            if (numbered && sequence != 0)
+            {
+                newSequences[sequence] = newDeposits.size();
+            }
+
+            newDepositIndex[epoch][id] = newDeposits.size();
+            newDeposits.push_back( std::make_pair( epoch, records[i].get() ));
+
+            results[i] = "Deposit Successful!";
         }
         else
         {
-            // if there are different selector strings, then the buyer cheated
-            std::cout << "The buyer cheated!  Possible identities ..." << std::endl;
+            doubleDeposits.push_back( std::make_pair( previous, records[i].get() ));
+
+            results[i] = "Deposit Unsuccessful!";
+        }
+    }
+
+    // each epoch's ledger is written before its deposits count as spent, one write per
+    // epoch in the batch, so memory never holds a deposit the ledger lacks.  A failed
+    // write throws before anything is reported, and the batch is sent again.
+    std::map<unsigned int, std::vector<const DepositRecord*>> byEpoch;
+    for (const auto& deposit : newDeposits)
+    {
+        byEpoch[deposit.first].push_back(deposit.second);
+    }
+    for (const auto& epoch : byEpoch)
+    {
+        Partition& partition = m_partitions[epoch.first];
+        if (partition.ledger)
+        {
+            std::vector<std::string> encoded;
+            for (const auto record : epoch.second)
+            {
+                encoded.push_back(record->Encoded());
+            }
 
-            int i = 0;
-            for (const auto& cd : it->second.identity_strings)
+            partition.ledger->Append(encoded);
+        }
+
+        for (const auto record : epoch.second)
+        {
+            partition.deposits.insert( std::make_pair( record->Id(), *record ));
+            if (record->Sequence() != 0)
             {
-                CommitData data1;
-                data1.Deserialize(cd);
+                partition.sequences[std::make_pair(identity, record->Sequence())] = record->Id();
+            }
+        }
+    }
 
-                CommitData data2;
-                data2.Deserialize(commitDataStrVector[i]);
+    for (const auto deposit : reusedSequences)
+    {
+        Log::Warning("deposit number reused").Field("depositor", identity)
+                                             .Field("sequence", deposit->Sequence())
+                                             .Field("coin", deposit->Id().Hex());
+    }
+
+    for (const auto& deposit : doubleDeposits)
+    {
+        ReportDoubleDeposit(identity, *deposit.first, *deposit.second);
+    }
+
+    deposits_accepted.Increment(newDeposits.size());
+    deposits_double.Increment(doubleDeposits.size());
+    deposits_expired.Increment(numExpired);
+    deposits_invalid.Increment(numInvalid);
 
-                std::cout << "Identity: " << SecretSplitting::GetSecret(Utilities::StringToNumber(data1.b),
-                                                                        Utilities::StringToNumber(data2.b)) << std::endl;
+    return results;
+}
 
-                ++i;
+void Bank::BankServer::ReportDoubleDeposit(const std::string&   identity,
+                                           const DepositRecord& previous,
+                                           const DepositRecord& deposit)
+{
+    // if the selector string match, then the merchant cheated
+    if (deposit.SameSelector(previous))
+    {
+        Log::Warning("double deposit").Field("cheater", "merchant")
+                                      .Field("depositor", identity)
+                                      .Field("coin", deposit.Id().Hex());
+    }
+    else
+    {
+        // if there are different selector strings, then the buyer cheated.  Wherever
+        // the selectors differ the bank now holds both halves of an identity string.
+        std::set<std::string> identities;
+        for (size_t i = 0; i < previous.Size() && i < deposit.Size(); ++i)
+        {
+            if (deposit.Left(i) == previous.Left(i))
+            {
+                continue;
             }
+
+            identities.insert(SecretSplitting::GetSecret(Utilities::StringToNumber(previous.Share(i)),
+                                                         Utilities::StringToNumber(deposit.Share(i))));
+        }
+
+        std::string identityList;
+        for (const auto& buyer : identities)
+        {
+            identityList += (identityList.empty() ? "" : ",") + buyer;
         }
 
-        WriteAndWaitForAcknowledge(sock1, "Deposit Unsuccessful!");
+        Log::Warning("double deposit").Field("cheater", "buyer")
+                                      .Field("depositor", identity)
+                                      .Field("coin", deposit.Id().Hex())
+                                      .Field("identities", identityList);
     }
 }
 
@@ -255,18 +944,225 @@ void Bank::BankServer::GetPublicKey(tcp::socket& sock1)
 {
     try
     {
-        std::string pub_str = pub.e.get_str(BASE);
-        std::string mod_str = pub.N.get_str(BASE);
+        // every key the bank still takes in one message, encoded when the keys last changed
+        std::shared_ptr<const std::string> keySet;
+        {
+            std::lock_guard<std::mutex> key_lock(m_key_mutex);
+            keySet = m_key_set;
+        }
+
+        WriteFramedAndWaitForAcknowledge(sock1, *keySet);
+    }
+    catch (std::exception& e)
+    {
+        Log::Error("exception").Field("in", "Bank::BankServer::GetPublicKey()").Field("error", e.what());
+    }
+}
+
+void Bank::BankServer::GetKeyId(tcp::socket& sock1)
+{
+    try
+    {
+        std::string keyId;
+        {
+            std::lock_guard<std::mutex> key_lock(m_key_mutex);
+            keyId = m_key_id;
+        }
 
-        WriteAndWaitForAcknowledge(sock1, pub_str);
-        WriteAndWaitForAcknowledge(sock1, mod_str);
+        WriteAndWaitForAcknowledge(sock1, keyId);
     }
     catch (std::exception& e)
     {
-        std::cerr << "Exception in Bank::BankServer::GetPublicKey(): " << e.what() << "\n";
+        Log::Error("exception").Field("in", "Bank::BankServer::GetKeyId()").Field("error", e.what());
     }
 }
 
+unsigned int Bank::BankServer::CurrentEpoch() const
+{
+    return m_options.epochSeconds ? std::time(NULL) / m_options.epochSeconds : 0;
+}
+
+void Bank::BankServer::Rotate()
+{
+    const unsigned int epoch = CurrentEpoch();
+    if (epoch == m_epoch)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> key_lock(m_key_mutex);
+
+    // another connection got here first
+    if (epoch <= m_epoch)
+    {
+        return;
+    }
+
+    AddEpoch(epoch, true);
+    DropEpochs((epoch > m_options.acceptEpochs) ? epoch - m_options.acceptEpochs : 0);
+    m_epoch = epoch;
+    PublishKeys();
+
+    Log::Info("rotated keys").Field("epoch", epoch);
+}
+
+void Bank::BankServer::AddEpoch(const unsigned int epoch, const bool make_keys)
+{
+    for (const auto denomination : m_options.denominations)
+    {
+        const std::string keyFile = KeyFile(epoch, denomination);
+
+        Rsa::KeyPair key_pair;
+        if (!keyFile.empty() && Rsa::ReadKeyPair(key_pair, keyFile))
+        {
+            Log::Info("loaded key pair").Field("file", keyFile);
+        }
+        else if (make_keys)
+        {
+            key_pair = m_key_pool.Take();
+
+            if (!keyFile.empty())
+            {
+                Rsa::WriteKeyPair(key_pair, keyFile);
+                Log::Info("saved new key pair").Field("file", keyFile);
+            }
+        }
+        else
+        {
+            continue;
+        }
+
+        m_keys[KeyId(epoch, denomination)] = key_pair;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Partition& partition = m_partitions[epoch];
+    if (m_options.ledgerFile.empty() || partition.ledger)
+    {
+        return;
+    }
+
+    const std::string ledgerFile = LedgerFile(epoch);
+    partition.ledger.reset( new DepositLedger(ledgerFile) );
+
+    // rebuild the spent money orders from the ledger
+    for (const auto& encoded : partition.ledger->Load())
+    {
+        try
+        {
+            DepositRecord record = DepositRecord::Decode(encoded);
+            partition.deposits.insert( std::make_pair( record.Id(), record ));
+            if (record.Sequence() != 0)
+            {
+                partition.sequences[std::make_pair(record.Depositor(), record.Sequence())] = record.Id();
+            }
+        }
+        catch (std::invalid_argument& e)
+        {
+            throw std::runtime_error("Unable to read deposit ledger " + ledgerFile + ", it holds a record this bank cannot read");
+        }
+    }
+
+    Log::Info("loaded deposits").Field("count", partition.deposits.size()).Field("file", ledgerFile);
+}
+
+void Bank::BankServer::DropEpochs(const unsigned int oldest)
+{
+    // an expired key signs nothing again, so it is not kept anywhere
+    const auto expired = m_keys.lower_bound(KeyId(oldest, 0));
+    for (auto key = m_keys.begin(); key != expired; ++key)
+    {
+        const std::string keyFile = KeyFile(key->first.first, key->first.second);
+        if (!keyFile.empty())
+        {
+            unlink(keyFile.c_str());
+        }
+    }
+    m_keys.erase(m_keys.begin(), expired);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    while (!m_partitions.empty() && m_partitions.begin()->first < oldest)
+    {
+        const unsigned int epoch = m_partitions.begin()->first;
+        Log::Info("epoch expired").Field("epoch", epoch)
+                                  .Field("deposits", m_partitions.begin()->second.deposits.size());
+
+        // the ledger is closed before its file goes
+        m_partitions.erase(m_partitions.begin());
+        if (!m_options.ledgerFile.empty())
+        {
+            unlink(LedgerFile(epoch).c_str());
+        }
+    }
+}
+
+void Bank::BankServer::PublishKeys()
+{
+    PublicKeySet keySet;
+    keySet.m_epoch = m_epoch;
+    for (const auto& key : m_keys)
+    {
+        keySet.m_keys[key.first] = std::make_pair(key.second.pub.N.get_str(BASE),
+                                                  key.second.pub.e.get_str(BASE));
+    }
+
+    m_key_set = std::make_shared<const std::string>(keySet.Serialize());
+    m_key_id  = PublicKeySet::Fingerprint(*m_key_set);
+
+    Log::Info("published keys").Field("epoch", keySet.m_epoch).Field("key_id", m_key_id);
+}
+
+std::string Bank::BankServer::KeyFile(const unsigned int epoch, const unsigned int denomination) const
+{
+    if (m_options.keyFile.empty())
+    {
+        return "";
+    }
+
+    return m_options.keyFile + (m_options.epochSeconds ? "." + std::to_string(epoch) : "")
+                             + "." + std::to_string(denomination);
+}
+
+std::string Bank::BankServer::LedgerFile(const unsigned int epoch) const
+{
+    return m_options.epochSeconds ? m_options.ledgerFile + "." + std::to_string(epoch)
+                                  : m_options.ledgerFile;
+}
+
+Rsa::KeyPair Bank::BankServer::SigningKey(const unsigned int epoch, const unsigned int amount)
+{
+    std::lock_guard<std::mutex> key_lock(m_key_mutex);
+
+    if (epoch != m_epoch)
+    {
+        throw std::invalid_argument("The bank does not sign money orders in epoch " + std::to_string(epoch));
+    }
+
+    auto key = m_keys.find(KeyId(epoch, amount));
+    if (key == m_keys.end())
+    {
+        throw std::invalid_argument("No denomination worth " + std::to_string(amount));
+    }
+
+    return key->second;
+}
+
+bool Bank::BankServer::DepositKey(const unsigned int epoch, const unsigned int amount, Rsa::PublicKey& pub)
+{
+    std::lock_guard<std::mutex> key_lock(m_key_mutex);
+
+    auto key = m_keys.find(KeyId(epoch, amount));
+    if (key == m_keys.end())
+    {
+        return false;
+    }
+
+    pub = key->second.pub;
+    return true;
+}
+
 void Bank::BankServer::OpenAccount(tcp::socket& sock1)
 {
     try
@@ -274,16 +1170,17 @@ void Bank::BankServer::OpenAccount(tcp::socket& sock1)
         std::string identity = ReadAndAcknowledge( sock1 );
         unsigned int amount  = std::atoi( ReadAndAcknowledge( sock1 ).c_str() );
 
+        std::lock_guard<std::mutex> lock(m_mutex);
         if (m_accounts.find( identity ) == m_accounts.end())
         {
             AccountInformation ai( amount );
             m_accounts.insert( std::pair<std::string, AccountInformation>( identity, ai ) );
-            std::cout << "New account opened for: " << identity << std::endl;
+            Log::Info("account opened").Field("identity", identity).Field("amount", amount);
         }
     }
     catch (std::exception& e)
     {
-        std::cerr << "Exception in Bank::BankServer::OpenAccount(): " << e.what() << "\n";
+        Log::Error("exception").Field("in", "Bank::BankServer::OpenAccount()").Field("error", e.what());
     }
 }
 
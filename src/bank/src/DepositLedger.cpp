@@ -0,0 +1,137 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#include "DepositLedger.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+    // every record starts with its length as a big endian 64 bit number
+    const size_t RECORD_HEADER_LENGTH = 8;
+}
+
+Bank::DepositLedger::DepositLedger( const std::string& filename )
+    : filename( filename )
+{
+    fd = open(filename.c_str(), O_RDWR | O_CREAT | O_APPEND, 0600);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Unable to open deposit ledger " + filename);
+    }
+}
+
+Bank::DepositLedger::~DepositLedger()
+{
+    close(fd);
+}
+
+std::vector<std::string> Bank::DepositLedger::Load()
+{
+    std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+    std::stringstream contents;
+    contents << in.rdbuf();
+    const std::string data = contents.str();
+
+    std::vector<std::string> records;
+    size_t offset = 0;
+    while (offset + RECORD_HEADER_LENGTH <= data.size())
+    {
+        uint64_t length = 0;
+        for (size_t i = 0; i < RECORD_HEADER_LENGTH; ++i)
+        {
+            length = (length << 8) | static_cast<unsigned char>(data[offset + i]);
+        }
+
+        if (length > data.size() - offset - RECORD_HEADER_LENGTH)
+        {
+            break;
+        }
+
+        records.push_back(data.substr(offset + RECORD_HEADER_LENGTH, length));
+        offset += RECORD_HEADER_LENGTH + length;
+    }
+
+    // drop a record that was cut short by a crash, so the next append starts clean
+    if (offset != data.size() && ftruncate(fd, offset) != 0)
+    {
+        throw std::runtime_error("Unable to repair deposit ledger " + filename);
+    }
+
+    return records;
+}
+
+void Bank::DepositLedger::Append( const std::vector<std::string>& records )
+{
+    std::string buffer;
+    for (const auto& record : records)
+    {
+        uint64_t length = record.size();
+        for (size_t i = RECORD_HEADER_LENGTH; i > 0; --i)
+        {
+            buffer.push_back(static_cast<char>((length >> (8*(i - 1))) & 0xFF));
+        }
+        buffer += record;
+    }
+
+    // where this append starts, so that a failed one can be taken back
+    const off_t start = lseek(fd, 0, SEEK_END);
+    if (start < 0)
+    {
+        throw std::runtime_error("Unable to write deposit ledger " + filename);
+    }
+
+    size_t written = 0;
+    while (written < buffer.size())
+    {
+        ssize_t n = write(fd, buffer.data() + written, buffer.size() - written);
+        if (n < 0)
+        {
+            Truncate(start);
+            throw std::runtime_error("Unable to write deposit ledger " + filename);
+        }
+        written += n;
+    }
+
+    if (fdatasync(fd) != 0)
+    {
+        Truncate(start);
+        throw std::runtime_error("Unable to sync deposit ledger " + filename);
+    }
+}
+
+void Bank::DepositLedger::Truncate( const off_t length )
+{
+    // a torn record left in the middle of the ledger would hide every record after it
+    // from Load(), so the file goes back to how it was.  If even that fails the bank
+    // cannot trust its ledger any more.
+    if (ftruncate(fd, length) != 0)
+    {
+        throw std::runtime_error("Unable to repair deposit ledger " + filename);
+    }
+}
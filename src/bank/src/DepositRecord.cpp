@@ -0,0 +1,186 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#include "DepositRecord.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+namespace
+{
+    const unsigned char VERSION = 3;
+
+    // version | id | amount | sequence | count | width | depositor length
+    const size_t ID_OFFSET               = 1;
+    const size_t AMOUNT_OFFSET           = ID_OFFSET + CoinId::LENGTH;
+    const size_t SEQUENCE_OFFSET         = AMOUNT_OFFSET + 4;
+    const size_t COUNT_OFFSET            = SEQUENCE_OFFSET + 8;
+    const size_t WIDTH_OFFSET            = COUNT_OFFSET + 2;
+    const size_t DEPOSITOR_LENGTH_OFFSET = WIDTH_OFFSET + 2;
+    const size_t SELECTOR_OFFSET         = DEPOSITOR_LENGTH_OFFSET + 2;
+
+    // the largest count, width and depositor length the record can hold
+    const size_t MAX_FIELD = 0xFFFF;
+
+    void PutNumber( std::string& out, const uint64_t value, const size_t length )
+    {
+        for (size_t i = length; i > 0; --i)
+        {
+            out.push_back(static_cast<char>((value >> (8*(i - 1))) & 0xFF));
+        }
+    }
+
+    uint64_t GetNumber( const std::string& in, const size_t offset, const size_t length )
+    {
+        uint64_t value = 0;
+        for (size_t i = 0; i < length; ++i)
+        {
+            value = (value << 8) | static_cast<unsigned char>(in[offset + i]);
+        }
+
+        return value;
+    }
+
+    size_t SelectorLength( const size_t count )
+    {
+        return (count + 7) / 8;
+    }
+}
+
+Bank::DepositRecord::DepositRecord( const CoinId&                   id,
+                                    const std::string&              depositor,
+                                    const unsigned int              amount,
+                                    const uint64_t                  sequence,
+                                    const std::string&              selector,
+                                    const std::vector<std::string>& shares )
+{
+    const size_t count = selector.size();
+    size_t width = 0;
+    for (const auto& share : shares)
+    {
+        width = std::max(width, share.size());
+    }
+
+    if (shares.size() != count || count > MAX_FIELD ||
+        width > MAX_FIELD || depositor.size() > MAX_FIELD)
+    {
+        throw std::invalid_argument("Deposit does not fit a deposit record");
+    }
+
+    m_data.reserve(SELECTOR_OFFSET + SelectorLength(count) + count * width + depositor.size());
+    m_data.push_back(static_cast<char>(VERSION));
+    m_data += id.Bytes();
+    PutNumber(m_data, amount, 4);
+    PutNumber(m_data, sequence, 8);
+    PutNumber(m_data, count, 2);
+    PutNumber(m_data, width, 2);
+    PutNumber(m_data, depositor.size(), 2);
+
+    std::string bits(SelectorLength(count), '\0');
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (selector[i] == '1')
+        {
+            bits[i / 8] |= static_cast<char>(1 << (i % 8));
+        }
+        else if (selector[i] != '2')
+        {
+            throw std::invalid_argument("Selectors are made of 1s and 2s");
+        }
+    }
+    m_data += bits;
+
+    for (const auto& share : shares)
+    {
+        m_data.append(width - share.size(), '\0');
+        m_data += share;
+    }
+
+    m_data += depositor;
+}
+
+Bank::DepositRecord Bank::DepositRecord::Decode( const std::string& encoded )
+{
+    if (encoded.size() < SELECTOR_OFFSET || static_cast<unsigned char>(encoded[0]) != VERSION)
+    {
+        throw std::invalid_argument("Not a deposit record");
+    }
+
+    const size_t count = GetNumber(encoded, COUNT_OFFSET, 2);
+    const size_t width = GetNumber(encoded, WIDTH_OFFSET, 2);
+    const size_t depositor_length = GetNumber(encoded, DEPOSITOR_LENGTH_OFFSET, 2);
+    if (encoded.size() != SELECTOR_OFFSET + SelectorLength(count) + count * width + depositor_length)
+    {
+        throw std::invalid_argument("Not a deposit record");
+    }
+
+    DepositRecord record;
+    record.m_data = encoded;
+    return record;
+}
+
+CoinId Bank::DepositRecord::Id() const
+{
+    return CoinId(m_data.substr(ID_OFFSET, CoinId::LENGTH));
+}
+
+std::string Bank::DepositRecord::Depositor() const
+{
+    const size_t count = Size();
+    return m_data.substr(SELECTOR_OFFSET + SelectorLength(count) + count * GetNumber(m_data, WIDTH_OFFSET, 2));
+}
+
+unsigned int Bank::DepositRecord::Amount() const
+{
+    return GetNumber(m_data, AMOUNT_OFFSET, 4);
+}
+
+uint64_t Bank::DepositRecord::Sequence() const
+{
+    return GetNumber(m_data, SEQUENCE_OFFSET, 8);
+}
+
+size_t Bank::DepositRecord::Size() const
+{
+    return GetNumber(m_data, COUNT_OFFSET, 2);
+}
+
+bool Bank::DepositRecord::Left( const size_t i ) const
+{
+    return (static_cast<unsigned char>(m_data[SELECTOR_OFFSET + i / 8]) >> (i % 8)) & 1;
+}
+
+std::string Bank::DepositRecord::Share( const size_t i ) const
+{
+    const size_t width = GetNumber(m_data, WIDTH_OFFSET, 2);
+    return m_data.substr(SELECTOR_OFFSET + SelectorLength(Size()) + i * width, width);
+}
+
+bool Bank::DepositRecord::SameSelector( const DepositRecord& other ) const
+{
+    const size_t count = Size();
+    return count == other.Size() &&
+           m_data.compare(SELECTOR_OFFSET, SelectorLength(count),
+                          other.m_data, SELECTOR_OFFSET, SelectorLength(count)) == 0;
+}
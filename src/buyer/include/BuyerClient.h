@@ -0,0 +1,69 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#ifndef BUYERCLIENT_H
+#define BUYERCLIENT_H
+
+#include <string>
+
+namespace Buyer
+{
+    // Each step returns false, after printing why, if it did not complete.
+
+    bool OpenAccount( const char* host, 
+                      const char* port, 
+                      const std::string& identity, 
+                      const unsigned int amount );
+
+    // withdraws a money order worth amount from the bank and adds it, with what is
+    // needed to spend it, to the wallet filename, which is made if there is none
+    bool GenerateMoneyOrder( const char* host, 
+                             const char* port, 
+                             const std::string& identity, 
+                             const unsigned int amount, 
+                             const std::string& filename );
+
+    // withdraws count money orders worth amount each in one session with the bank
+    // and adds them, with what is needed to spend them, to the wallet filename
+    bool GenerateMoneyOrders( const char* host, 
+                              const char* port, 
+                              const std::string& identity, 
+                              const unsigned int amount, 
+                              const unsigned int count, 
+                              const std::string& filename );
+
+    // spends the first money order of the wallet filename that has not been spent
+    // at the merchant
+    bool BuyItem( const char* host, 
+                  const char* port, 
+                  const std::string& filename );
+
+    // spends the index-th money order of the wallet filename at the merchant, even
+    // if it has been spent before
+    bool BuyItem( const char* host, 
+                  const char* port, 
+                  const std::string& filename,
+                  const unsigned int index );
+}
+
+#endif // BUYERCLIENT_H
@@ -0,0 +1,589 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#include "BuyerClient.h"
+
+#include "BitCommitment.h"
+#include "BlindSignature.h"
+#include "Coin.h"
+#include "MoneyOrder.h"
+#include "MoneyOrderInfo.h"
+#include "Parallel.h"
+#include "PublicKeySet.h"
+#include "Random.h"
+#include "RevealedHalves.h"
+#include "Rsa.h"
+#include "SecretSplitting.h"
+#include "Utilities.h"
+#include "Wallet.h"
+#include "WithdrawalBatch.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <iostream>
+
+#include "NetComm.h"
+
+namespace
+{
+    // the most work the bank may ask of the buyer for one withdrawal
+    const unsigned int MAX_MONEY_ORDERS  = 4096;
+    const unsigned int MAX_IDENT_STRINGS = 4096;
+    const unsigned int BASE = 10;
+
+    // the key the bank signs a denomination with now, and the epoch it belongs to.  Lists
+    // the denominations the bank has and ends the session if it has no key for amount.
+    bool GetPublicKey( NetComm::Client& bankClient, const unsigned int amount, Rsa::PublicKey& pub, unsigned int& epoch )
+    {
+        bankClient.WriteAndWaitForAcknowledge("GET PUBLIC KEY");
+
+        PublicKeySet keySet;
+        keySet.Deserialize( bankClient.ReadFramedAndAcknowledge() );
+
+        epoch = keySet.m_epoch;
+        auto key = keySet.m_keys.find(PublicKeySet::KeyId(epoch, amount));
+        if (key == keySet.m_keys.end())
+        {
+            std::cerr << "The bank does not issue money orders worth " << amount << ". Denominations:";
+            for (const auto& k : keySet.m_keys)
+            {
+                if (k.first.first == epoch)
+                {
+                    std::cerr << " " << k.first.second;
+                }
+            }
+            std::cerr << "\n";
+
+            bankClient.WriteAndWaitForAcknowledge("CLOSE CONNECTION");
+            return false;
+        }
+
+        pub = Rsa::PublicKey((mpz_class(key->second.first, BASE)), (mpz_class(key->second.second, BASE)));
+        return true;
+    }
+
+    // the bank decides how many money orders to make per coin, and how many identity
+    // strings each; false if it asks for more than the buyer is willing to do
+    bool ReadWithdrawalPolicy( NetComm::Client& bankClient, unsigned int& num_money_orders, unsigned int& num_ident_strings )
+    {
+        num_money_orders  = std::atoi(bankClient.ReadAndAcknowledge().c_str());
+        num_ident_strings = std::atoi(bankClient.ReadAndAcknowledge().c_str());
+        if (num_money_orders < 2 || num_money_orders > MAX_MONEY_ORDERS ||
+            num_ident_strings < 1 || num_ident_strings > MAX_IDENT_STRINGS)
+        {
+            std::cerr << "The bank asked for " << num_money_orders << " money orders with "
+                      << num_ident_strings << " identity strings each!\n";
+            return false;
+        }
+
+        return true;
+    }
+
+    // Makes a money order worth amount that hides identity in num_ident_strings identity
+    // strings.  Returns the blinded full domain hash the bank signs, a single block however
+    // many identity strings there are; the serialized money order goes to serial and what
+    // is needed to open or spend it to info.
+    mpz_class MakeMoneyOrder( const std::string&                   identity,
+                              const unsigned int                   amount,
+                              const unsigned int                   num_ident_strings,
+                              const Rsa::PublicKey&                pub,
+                              const BlindSignature::BlindingFactor& blinding_factor,
+                              std::string&                         serial,
+                              MoneyOrderInfo&                      info )
+    {
+        MoneyOrder ord;
+        mpz_class  left;
+        mpz_class  right;
+
+        info.m_amount = amount;
+        ord.m_uniqueness = CoinId(Random::GenerateRandomBytes(CoinId::LENGTH));
+
+        for (unsigned int j = 0; j < num_ident_strings; ++j)
+        {
+            std::tie(left, right) = SecretSplitting::SplitSecret(identity);
+
+            CommitData leftCommitData = GenCommitData(left);
+            std::string leftHash = Hash( leftCommitData );
+
+            CommitData rightCommitData = GenCommitData(right);
+            std::string rightHash = Hash( rightCommitData );
+
+            info.m_commit_data.push_back(std::pair<CommitData, CommitData>(leftCommitData, rightCommitData));
+
+            ord.m_identity_strings.push_back(
+                    MoneyOrder::IdentityPair(
+                        CommitPair( leftHash, leftCommitData.r1 ),
+                        CommitPair( rightHash, rightCommitData.r1 )));
+        }
+
+        serial = ord.Serialize();
+
+        // Blind the money order's hash using the banks public key, and save off the
+        // blinding factor
+        mpz_class factor;
+        mpz_class blinded_text;
+        std::tie(blinded_text, factor) = BlindSignature::Blind(Rsa::FullDomainHash(serial, pub), pub, blinding_factor, false);
+        info.m_blinding_factor = factor.get_str(BASE);
+
+        return blinded_text;
+    }
+
+    // unblinds the bank's signature on a money order; a coin the merchant would refuse
+    // is no use, so false if the signature does not verify
+    bool MakeCoin( const std::string&    signed_money_order,
+                   const std::string&    money_order,
+                   const MoneyOrderInfo& info,
+                   const Rsa::PublicKey& pub,
+                   const unsigned int    epoch,
+                   Coin&                 coin )
+    {
+        mpz_class signature =
+            BlindSignature::Unblind( mpz_class( signed_money_order, BASE),
+                                     pub,
+                                     mpz_class( info.m_blinding_factor, BASE),
+                                     false );
+
+        if (!Rsa::VerifyFullDomainHash(money_order, signature, pub))
+        {
+            return false;
+        }
+
+        coin.m_money_order = money_order;
+        coin.m_signature   = signature.get_str(BASE);
+        coin.m_amount      = info.m_amount;
+        coin.m_epoch       = epoch;
+        return true;
+    }
+
+    // a coin and what is needed to spend it, as the wallet stores them
+    Wallet::Entry WalletEntry( Coin& coin, MoneyOrderInfo& info )
+    {
+        MoneyOrder ord;
+        ord.Deserialize(coin.m_money_order);
+
+        Wallet::Entry entry;
+        entry.id     = ord.m_uniqueness;
+        entry.amount = coin.m_amount;
+        entry.coin   = coin.Serialize();
+        entry.info   = info.Serialize();
+        return entry;
+    }
+
+    // spends a coin at the merchant, opening the halves of its identity strings the
+    // merchant picks
+    bool SpendCoin( const char* host, const char* port, Coin& coin, MoneyOrderInfo& moneyOrderInfo )
+    {
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // Connect
+        NetComm::Client merchantClient(host, port);
+        merchantClient.Connect();
+
+        // the coin carries its epoch and denomination, which pick the bank key the merchant checks it with
+        merchantClient.WriteFramedAndWaitForAcknowledge( coin.Serialize() );
+
+        // tell the merchant how long a selector string to make, so that it does not
+        // have to wait for the signature to be checked
+        merchantClient.WriteAndWaitForAcknowledge( std::to_string(moneyOrderInfo.m_commit_data.size()) );
+
+        std::string bString = merchantClient.ReadAndAcknowledge();
+
+        if (bString.size() != moneyOrderInfo.m_commit_data.size())
+        {
+            std::cerr << "The merchant sent a selector of the wrong length!\n";
+            return false;
+        }
+
+        // reveal the selected halves all at once
+        RevealedHalves revealed;
+        for(unsigned int i = 0; i < bString.size(); ++i)
+        {
+            if (bString[i] == '1') 
+            { 
+                revealed.m_commit_data.push_back( moneyOrderInfo.m_commit_data[i].first.Serialize() );
+            }
+            else
+            {
+                revealed.m_commit_data.push_back( moneyOrderInfo.m_commit_data[i].second.Serialize() );
+            }
+        }
+
+        merchantClient.WriteFramedAndWaitForAcknowledge( revealed.Serialize() );
+        return true;
+    }
+}
+
+bool Buyer::BuyItem( const char* host, 
+                     const char* port, 
+                     const std::string& filename )
+{
+    try
+    {
+        size_t index;
+        size_t size;
+        {
+            Wallet wallet(filename);
+            index = wallet.FirstUnspent();
+            size  = wallet.Size();
+        }
+
+        if (index == size)
+        {
+            std::cerr << "Every coin in " << filename << " has been spent\n";
+            return false;
+        }
+
+        return BuyItem(host, port, filename, index);
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << "\n";
+        return false;
+    }
+}
+
+bool Buyer::BuyItem( const char* host, 
+                     const char* port, 
+                     const std::string& filename,
+                     const unsigned int index )
+{
+    try
+    {
+        Wallet wallet(filename);
+
+        // spending a coin twice is allowed, the bank will find out who did it
+        if (wallet.Index(index).spent)
+        {
+            std::cerr << "Coin " << index << " of " << filename << " has been spent before\n";
+        }
+
+        Coin coin;
+        coin.Deserialize(wallet.CoinData(index));
+        MoneyOrderInfo moneyOrderInfo;
+        moneyOrderInfo.Deserialize(wallet.InfoData(index));
+
+        if (!SpendCoin(host, port, coin, moneyOrderInfo))
+        {
+            return false;
+        }
+
+        wallet.MarkSpent(index);
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool Buyer::GenerateMoneyOrder( const char* host, 
+                                const char* port, 
+                                const std::string& identity, 
+                                const unsigned int amount,
+                                const std::string& filename )
+{
+    try
+    {
+        std::vector<std::string>    money_orders;
+        std::vector<MoneyOrderInfo> money_orders_info;
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // Connect
+        NetComm::Client bankClient(host, port);
+        bankClient.Connect();
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // Get Bank's Key for this denomination
+        Rsa::PublicKey pub;
+        unsigned int   epoch;
+        if (!GetPublicKey(bankClient, amount, pub, epoch))
+        {
+            return false;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // Send sign money order command
+        bankClient.WriteAndWaitForAcknowledge("SIGN MONEY ORDER");
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // Write out identity string, amount and the epoch of the key
+        bankClient.WriteAndWaitForAcknowledge(identity);
+        bankClient.WriteAndWaitForAcknowledge(std::to_string(amount));
+        bankClient.WriteAndWaitForAcknowledge(std::to_string(epoch));
+
+        unsigned int num_money_orders;
+        unsigned int num_ident_strings;
+        if (!ReadWithdrawalPolicy(bankClient, num_money_orders, num_ident_strings))
+        {
+            return false;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // Prepare and Write Money Orders
+
+        // the blinding factors do not depend on the money orders, so they are made in
+        // the background while the first money order is put together
+        std::future<std::vector<BlindSignature::BlindingFactor>> pending_factors =
+            std::async(std::launch::async, BlindSignature::GenerateBlindingFactors, std::cref(pub), num_money_orders);
+        std::vector<BlindSignature::BlindingFactor> blinding_factors;
+
+        money_orders.resize(num_money_orders);
+        money_orders_info.resize(num_money_orders);
+        for (unsigned int i = 0; i < num_money_orders; ++i)
+        {
+            if (blinding_factors.empty())
+            {
+                blinding_factors = pending_factors.get();
+            }
+
+            mpz_class blinded_text = MakeMoneyOrder(identity, amount, num_ident_strings, pub, blinding_factors[i],
+                                                    money_orders[i], money_orders_info[i]);
+
+            // write each money order to the network
+            bankClient.WriteAndWaitForAcknowledge( blinded_text.get_str(BASE) );
+        }
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // Receive the selection, 'S' marks the money order that will be signed and 'R' the
+        // ones the bank wants to see opened
+        std::string selection = bankClient.ReadAndAcknowledge();
+        size_t mo_num = selection.find('S');
+        if (selection.size() != num_money_orders || mo_num == std::string::npos)
+        {
+            std::cerr << "The bank sent an invalid selection!\n";
+            return false;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // Send Money Order Info and open the money order itself
+        for (unsigned int i = 0; i < money_orders_info.size(); ++i)
+        {
+            if (selection[i] == 'R')
+            {
+                bankClient.WriteFramedAndWaitForAcknowledge( money_orders_info[i].Serialize() );
+                bankClient.WriteFramedAndWaitForAcknowledge( money_orders[i] );
+            }
+        }
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // receive the signed money order from the bank
+        std::string signed_money_order = bankClient.ReadAndAcknowledge();
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // close connection with bank
+        bankClient.WriteAndWaitForAcknowledge("CLOSE CONNECTION");
+
+        Coin coin;
+        if (!MakeCoin(signed_money_order, money_orders[mo_num], money_orders_info[mo_num], pub, epoch, coin))
+        {
+            std::cerr << "The bank's signature does not verify!\n";
+            return false;
+        }
+
+        Wallet::Append(filename, std::vector<Wallet::Entry>(1, WalletEntry(coin, money_orders_info[mo_num])));
+
+        std::cout << "Signed money order received and added to the wallet" << std::endl;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool Buyer::GenerateMoneyOrders( const char* host, 
+                                 const char* port, 
+                                 const std::string& identity, 
+                                 const unsigned int amount,
+                                 const unsigned int count,
+                                 const std::string& filename )
+{
+    try
+    {
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // Connect
+        NetComm::Client bankClient(host, port);
+        bankClient.Connect();
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // Get Bank's Key for this denomination
+        Rsa::PublicKey pub;
+        unsigned int   epoch;
+        if (!GetPublicKey(bankClient, amount, pub, epoch))
+        {
+            return false;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // Ask for count coins, the bank answers with how to make each
+        bankClient.WriteAndWaitForAcknowledge("SIGN MONEY ORDERS");
+        bankClient.WriteAndWaitForAcknowledge(identity);
+        bankClient.WriteAndWaitForAcknowledge(std::to_string(amount));
+        bankClient.WriteAndWaitForAcknowledge(std::to_string(epoch));
+        bankClient.WriteAndWaitForAcknowledge(std::to_string(count));
+
+        unsigned int num_money_orders;
+        unsigned int num_ident_strings;
+        if (!ReadWithdrawalPolicy(bankClient, num_money_orders, num_ident_strings))
+        {
+            return false;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // Make every coin's money orders and send them in one message
+        const size_t num_total = static_cast<size_t>(count) * num_money_orders;
+
+        std::vector<BlindSignature::BlindingFactor> blinding_factors =
+            BlindSignature::GenerateBlindingFactors(pub, num_total);
+
+        std::vector<std::string>    money_orders(num_total);
+        std::vector<MoneyOrderInfo> money_orders_info(num_total);
+        BlindedMoneyOrders          blinded;
+        blinded.m_money_orders.resize(num_total);
+
+        Parallel::For(num_total, [&](size_t i)
+        {
+            blinded.m_money_orders[i] = MakeMoneyOrder(identity, amount, num_ident_strings, pub, blinding_factors[i],
+                                                       money_orders[i], money_orders_info[i]).get_str(BASE);
+        });
+
+        bankClient.WriteFramedAndWaitForAcknowledge( blinded.Serialize() );
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // Receive the selection, one 'S' per coin and the 'R's to open
+        std::string selection = bankClient.ReadFramedAndAcknowledge();
+        std::vector<size_t> signed_indices;
+        bool valid = (selection.size() == num_total);
+        for (size_t k = 0; valid && k < count; ++k)
+        {
+            size_t first = k*num_money_orders;
+            size_t mo_num = selection.find('S', first);
+            valid = (mo_num < first + num_money_orders) &&
+                    (selection.find('S', mo_num + 1) >= first + num_money_orders);
+            signed_indices.push_back(mo_num);
+        }
+        if (!valid)
+        {
+            std::cerr << "The bank sent an invalid selection!\n";
+            return false;
+        }
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // Open the money orders the bank asked for, all in one message
+        OpenedMoneyOrders opened;
+        for (size_t i = 0; i < num_total; ++i)
+        {
+            if (selection[i] == 'R')
+            {
+                opened.m_info.push_back( money_orders_info[i].Serialize() );
+                opened.m_money_orders.push_back( money_orders[i] );
+            }
+        }
+        bankClient.WriteFramedAndWaitForAcknowledge( opened.Serialize() );
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // receive the signed money orders from the bank, none if it refused
+        SignedMoneyOrders signatures;
+        signatures.Deserialize( bankClient.ReadFramedAndAcknowledge() );
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // close connection with bank
+        bankClient.WriteAndWaitForAcknowledge("CLOSE CONNECTION");
+
+        if (signatures.m_signatures.size() != count)
+        {
+            std::cerr << "The bank refused to sign the money orders!\n";
+            return false;
+        }
+
+        std::vector<Coin> coins(count);
+        std::vector<char> verified(count);
+        Parallel::For(count, [&](size_t k)
+        {
+            size_t mo_num = signed_indices[k];
+            verified[k] = MakeCoin(signatures.m_signatures[k], money_orders[mo_num], money_orders_info[mo_num],
+                                   pub, epoch, coins[k]);
+        });
+
+        if (std::find(verified.begin(), verified.end(), 0) != verified.end())
+        {
+            std::cerr << "The bank's signature does not verify!\n";
+            return false;
+        }
+
+        std::vector<Wallet::Entry> entries;
+        for (size_t k = 0; k < count; ++k)
+        {
+            entries.push_back( WalletEntry(coins[k], money_orders_info[signed_indices[k]]) );
+        }
+        Wallet::Append(filename, entries);
+
+        std::cout << count << " signed money orders received and added to the wallet" << std::endl;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool Buyer::OpenAccount( const char* host, 
+                         const char* port, 
+                         const std::string& identity, 
+                         const unsigned int amount )
+{
+    try
+    {
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // Connect
+        NetComm::Client bankClient(host, port);
+        bankClient.Connect();
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // Send bank open account commend
+        bankClient.WriteAndWaitForAcknowledge("OPEN ACCOUNT");
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        // Send identity and initial account amount to bank
+        bankClient.WriteAndWaitForAcknowledge( identity );
+        bankClient.WriteAndWaitForAcknowledge( std::to_string( amount ) );
+
+        bankClient.WriteAndWaitForAcknowledge("CLOSE CONNECTION");
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << "\n";
+        return false;
+    }
+
+    return true;
+}
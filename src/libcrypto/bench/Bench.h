@@ -0,0 +1,63 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+namespace Bench
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+    //! Handed to every benchmark.  A benchmark does its setup and then calls Run()
+    //! once per operation it measures, e.g. once per key size.
+    /////////////////////////////////////////////////////////////////////////////////////
+    class State
+    {
+        public:
+            explicit State( const std::string& filter ) : filter( filter ) {}
+
+            // Repeats op until the run takes long enough to time, then prints
+            // ns/op and allocations/op under label.  Skipped unless the label
+            // contains the filter given on the command line.
+            void Run( const std::string& label, const std::function<void()>& op );
+
+        private:
+            std::string filter;
+    };
+
+    typedef std::function<void(State&)> Benchmark;
+
+    // called through BENCHMARK() below, before main runs
+    bool Register( const std::string& name, const Benchmark& benchmark );
+
+    // every allocation made so far, by GMP and by operator new
+    size_t Allocations();
+};
+
+#define BENCHMARK(function) \
+    namespace { const bool function##_registered = Bench::Register( #function, function ); }
+
+#endif // BENCH_H
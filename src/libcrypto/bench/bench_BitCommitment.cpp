@@ -0,0 +1,54 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#include "Bench.h"
+
+#include <gmpxx.h>
+#include <string>
+#include <vector>
+
+#include "BitCommitment.h"
+#include "SecretSplitting.h"
+
+namespace
+{
+    void BitCommitmentBenchmarks(Bench::State& state)
+    {
+        mpz_class left;
+        mpz_class right;
+        std::tie(left, right) = SecretSplitting::SplitSecret("alice");
+
+        CommitData commitData = GenCommitData(left);
+        std::string hash = Hash(commitData);
+
+        state.Run("BitCommitment::GenCommitData", [&]{ GenCommitData(left); });
+        state.Run("BitCommitment::Hash",          [&]{ Hash(commitData); });
+        state.Run("BitCommitment::Verify",        [&]{ Verify(commitData, hash, commitData.r1); });
+
+        std::vector<CommitData> commitDataBatch(100, commitData);
+        std::vector<CommitPair> originals(100, CommitPair(hash, commitData.r1));
+        state.Run("BitCommitment::VerifyBatch(x100)", [&]{ VerifyBatch(commitDataBatch, originals); });
+    }
+}
+
+BENCHMARK(BitCommitmentBenchmarks)
@@ -0,0 +1,67 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#include "Bench.h"
+
+#include <gmpxx.h>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "BlindSignature.h"
+#include "Rsa.h"
+#include "Utilities.h"
+
+namespace
+{
+    void BlindSignatureBenchmarks(Bench::State& state)
+    {
+        // about the size of a serialized money order
+        mpz_class plain_text = Utilities::StringToNumber(std::string(8000, 'x'));
+
+        for (int num_bits : { 512, 1024, 2048 })
+        {
+            const std::string size = "/" + std::to_string(num_bits);
+            Rsa::KeyPair key_pair = Rsa::GenerateKeyPair(num_bits);
+
+            mpz_class blinded_text;
+            mpz_class unblinding_factor;
+            std::tie(blinded_text, unblinding_factor) = BlindSignature::Blind(plain_text, key_pair.pub, true);
+            mpz_class signed_blinded_text = Rsa::Sign(blinded_text, key_pair, false);
+
+            std::vector<BlindSignature::BlindingFactor> factors =
+                BlindSignature::GenerateBlindingFactors(key_pair.pub, 1);
+
+            state.Run("BlindSignature::Blind(8000B)" + size,
+                      [&]{ BlindSignature::Blind(plain_text, key_pair.pub, true); });
+            state.Run("BlindSignature::Blind(8000B,factor)" + size,
+                      [&]{ BlindSignature::Blind(plain_text, key_pair.pub, factors[0], true); });
+            state.Run("BlindSignature::Unblind(8000B)" + size,
+                      [&]{ BlindSignature::Unblind(signed_blinded_text, key_pair.pub, unblinding_factor, false); });
+            state.Run("BlindSignature::GenerateBlindingFactors(x100)" + size,
+                      [&]{ BlindSignature::GenerateBlindingFactors(key_pair.pub, 100); });
+        }
+    }
+}
+
+BENCHMARK(BlindSignatureBenchmarks)
@@ -0,0 +1,49 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#include "Bench.h"
+
+#include <gmpxx.h>
+#include <string>
+
+#include "Random.h"
+
+namespace
+{
+    void RandomBenchmarks(Bench::State& state)
+    {
+        for (unsigned int num_bits : { 256, 1024 })
+        {
+            const std::string size = "/" + std::to_string(num_bits);
+            mpz_class range = Random::GenerateRandomNumberBits(num_bits);
+
+            state.Run("Random::GenerateRandomNumberBits" + size,       [&]{ Random::GenerateRandomNumberBits(num_bits); });
+            state.Run("Random::GenerateRandomNumberRange" + size,      [&]{ Random::GenerateRandomNumberRange(range); });
+            state.Run("Random::GenerateRandomNumbersRange(x100)" + size, [&]{ Random::GenerateRandomNumbersRange(range, 100); });
+        }
+
+        state.Run("Random::Sample(100,10)", [&]{ Random::Sample(100, 10); });
+    }
+}
+
+BENCHMARK(RandomBenchmarks)
@@ -0,0 +1,86 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#include "Bench.h"
+
+#include <gmpxx.h>
+#include <string>
+#include <vector>
+
+#include "Rsa.h"
+#include "Utilities.h"
+
+namespace
+{
+    void RsaBenchmarks(Bench::State& state)
+    {
+        mpz_class plain_text = Utilities::StringToNumber("this is a very secret message");
+
+        for (int num_bits : { 512, 1024, 2048 })
+        {
+            const std::string size = "/" + std::to_string(num_bits);
+            Rsa::KeyPair key_pair = Rsa::GenerateKeyPair(num_bits);
+
+            mpz_class cipher_text = Rsa::Encipher(plain_text, key_pair.pub, true);
+            mpz_class signed_text = Rsa::Sign(plain_text, key_pair, true);
+
+            state.Run("Rsa::Encipher" + size, [&]{ Rsa::Encipher(plain_text, key_pair.pub, true); });
+            state.Run("Rsa::Decipher" + size, [&]{ Rsa::Decipher(cipher_text, key_pair.priv, key_pair.pub, true); });
+            state.Run("Rsa::Sign" + size,     [&]{ Rsa::Sign(plain_text, key_pair.priv, key_pair.pub, true); });
+            state.Run("Rsa::Sign(CRT)" + size, [&]{ Rsa::Sign(plain_text, key_pair, true); });
+            state.Run("Rsa::Unsign" + size,   [&]{ Rsa::Unsign(signed_text, key_pair.pub, true); });
+
+            std::vector<mpz_class> signed_texts(100, signed_text);
+            state.Run("Rsa::Unsign(x100)" + size, [&]{ Rsa::Unsign(signed_texts, key_pair.pub, true); });
+
+            // a message of many blocks, which are spread over the hardware threads
+            mpz_class long_text = Utilities::StringToNumber(std::string(4 * 1024, 'm'));
+            mpz_class long_signed_text = Rsa::Sign(long_text, key_pair, true);
+
+            state.Run("Rsa::Sign(4KB)" + size,   [&]{ Rsa::Sign(long_text, key_pair, true); });
+            state.Run("Rsa::Unsign(4KB)" + size, [&]{ Rsa::Unsign(long_signed_text, key_pair.pub, true); });
+
+            // a money order sized message, signed as a full domain hash
+            const std::string message(32 * 1024, 'm');
+            mpz_class signature = Rsa::Sign(Rsa::FullDomainHash(message, key_pair.pub), key_pair, false);
+
+            state.Run("Rsa::FullDomainHash(32KB)" + size,       [&]{ Rsa::FullDomainHash(message, key_pair.pub); });
+            state.Run("Rsa::VerifyFullDomainHash(32KB)" + size, [&]{ Rsa::VerifyFullDomainHash(message, signature, key_pair.pub); });
+
+            // a deposit batch of 100 coins, one by one and screened together
+            std::vector<std::string> messages;
+            std::vector<mpz_class>   signatures;
+            for (unsigned int i = 0; i < 100; ++i)
+            {
+                messages.push_back("money order " + std::to_string(i));
+                signatures.push_back(Rsa::Sign(Rsa::FullDomainHash(messages.back(), key_pair.pub), key_pair, false));
+            }
+
+            state.Run("Rsa::VerifyFullDomainHash(x100)" + size, [&]{ Rsa::VerifyFullDomainHash(messages, signatures, key_pair.pub); });
+            state.Run("Rsa::ScreenFullDomainHash(x100)" + size, [&]{ Rsa::ScreenFullDomainHash(messages, signatures, key_pair.pub); });
+            state.Run("Rsa::ScreenFullDomainHash(x100,64)" + size, [&]{ Rsa::ScreenFullDomainHash(messages, signatures, key_pair.pub, 64); });
+        }
+    }
+}
+
+BENCHMARK(RsaBenchmarks)
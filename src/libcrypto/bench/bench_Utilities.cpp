@@ -0,0 +1,61 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#include "Bench.h"
+
+#include <gmpxx.h>
+#include <string>
+#include <tuple>
+
+#include "Random.h"
+#include "Utilities.h"
+
+namespace
+{
+    void UtilitiesBenchmarks(Bench::State& state)
+    {
+        for (unsigned int num_bits : { 256, 1024, 2048 })
+        {
+            const std::string size = "/" + std::to_string(num_bits);
+
+            mpz_class m = Random::GenerateRandomNumberBits(num_bits) | 1;
+            mpz_class a = Random::GenerateRandomNumberBits(num_bits - 1);
+            mpz_class e = 65537;
+            mpz_class d = Random::GenerateRandomNumberBits(num_bits - 1);
+
+            state.Run("Utilities::FastExp(e=65537)" + size, [&]{ Utilities::FastExp(a, e, m); });
+            state.Run("Utilities::FastExp(full)" + size,    [&]{ Utilities::FastExp(a, d, m); });
+            state.Run("Utilities::ExtendedGcd" + size,      [&]{ Utilities::ExtendedGcd(m, a); });
+
+            mpz_class inverse;
+            state.Run("Utilities::ModInverse" + size,       [&]{ Utilities::ModInverse(inverse, a, m); });
+        }
+
+        std::string message(1000, 'x');
+        mpz_class number = Utilities::StringToNumber(message);
+        state.Run("Utilities::StringToNumber/1000B", [&]{ Utilities::StringToNumber(message); });
+        state.Run("Utilities::NumberToString/1000B", [&]{ Utilities::NumberToString(number); });
+    }
+}
+
+BENCHMARK(UtilitiesBenchmarks)
@@ -0,0 +1,142 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#include "Bench.h"
+
+#include <gmp.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    // a run has to take at least this long before its timing is trusted
+    const std::chrono::milliseconds MIN_RUN_TIME(200);
+
+    std::atomic<size_t> allocations(0);
+
+    void* (*gmp_allocate)(size_t);
+    void* (*gmp_reallocate)(void*, size_t, size_t);
+    void  (*gmp_free)(void*, size_t);
+
+    void* CountingAllocate(size_t size)
+    {
+        ++allocations;
+        return gmp_allocate(size);
+    }
+
+    void* CountingReallocate(void* ptr, size_t old_size, size_t new_size)
+    {
+        ++allocations;
+        return gmp_reallocate(ptr, old_size, new_size);
+    }
+
+    std::vector<std::pair<std::string, Bench::Benchmark>>& Benchmarks()
+    {
+        static std::vector<std::pair<std::string, Bench::Benchmark>> benchmarks;
+        return benchmarks;
+    }
+}
+
+void* operator new(size_t size)
+{
+    ++allocations;
+    if (void* ptr = std::malloc(size ? size : 1))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+size_t Bench::Allocations()
+{
+    return allocations;
+}
+
+bool Bench::Register( const std::string& name, const Benchmark& benchmark )
+{
+    Benchmarks().push_back( std::make_pair(name, benchmark) );
+    return true;
+}
+
+void Bench::State::Run( const std::string& label, const std::function<void()>& op )
+{
+    if (label.find(filter) == std::string::npos)
+    {
+        return;
+    }
+
+    size_t iterations = 1;
+    while (true)
+    {
+        size_t allocations_before = Allocations();
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            op();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        size_t allocations_made = Allocations() - allocations_before;
+
+        if (elapsed >= MIN_RUN_TIME)
+        {
+            double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+            std::printf("%-52s %10zu %14.0f ns/op %10.1f allocs/op\n",
+                        label.c_str(), iterations, ns / iterations,
+                        static_cast<double>(allocations_made) / iterations);
+            return;
+        }
+
+        // aim a little past the minimum so the next run is usually the last
+        double ms = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() / 1000.0;
+        size_t scale = (ms < 1) ? 100 : static_cast<size_t>(1.5 * MIN_RUN_TIME.count() / ms) + 1;
+        iterations *= std::max<size_t>(scale, 2);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    // count GMP's allocations along with operator new's
+    mp_get_memory_functions(&gmp_allocate, &gmp_reallocate, &gmp_free);
+    mp_set_memory_functions(CountingAllocate, CountingReallocate, gmp_free);
+
+    // bench_libcrypto [filter], e.g. bench_libcrypto Rsa::Sign
+    Bench::State state( argc > 1 ? argv[1] : "" );
+
+    for (const auto& benchmark : Benchmarks())
+    {
+        benchmark.second(state);
+    }
+
+    return 0;
+}
@@ -29,6 +29,7 @@
 #include "Serializable.h"
 
 #include <tuple>
+#include <vector>
 #include <gmpxx.h>
 
 typedef std::pair<std::string, std::string> CommitPair;
@@ -68,5 +69,10 @@ bool        Verify( CommitData receivedCommitData,
                    std::string  originalHash, 
                    std::string  originalR1 );
 
+// true only if every receivedCommitData[i] opens originals[i], the commitments
+// are checked at once and spread over the hardware threads
+bool        VerifyBatch( const std::vector<CommitData>& receivedCommitData,
+                         const std::vector<CommitPair>& originals );
+
 #endif // BITCOMMITMENT_H
 
@@ -24,19 +24,46 @@
 #ifndef BLINDSIGNATURE_H
 #define BLINDSIGNATURE_H
 
+#include <cstddef>
 #include <gmpxx.h>
 #include <tuple>
+#include <vector>
 #include "Rsa.h"
 
 namespace BlindSignature
 {
+    // k^e and k^-1 mod N for a random blinding factor k
+    struct BlindingFactor
+    {
+        mpz_class k_e;
+        mpz_class k_inv;
+    };
+
+    // Blinding factors do not depend on the message, so they can be made ahead of
+    // time.  The whole batch shares a single modular inversion.
+    std::vector<BlindingFactor> GenerateBlindingFactors(const Rsa::PublicKey& public_key,
+                                                        const size_t          count);
+
+    // returns the blinded text and k^-1, the factor Unblind needs
+    std::tuple<mpz_class, mpz_class> Blind(const mpz_class&      plain_text,
+                                           const Rsa::PublicKey& public_key,
+                                           const bool            pad);
     std::tuple<mpz_class, mpz_class> Blind(const mpz_class&      plain_text,
                                            const Rsa::PublicKey& public_key,
+                                           const BlindingFactor& blinding_factor,
                                            const bool            pad);
     mpz_class Unblind(const mpz_class&      blinded_text,
                       const Rsa::PublicKey& public_key,
                       const mpz_class&      blind_factor,
                       const bool            pad);
+
+    // true if blinded_text is message_hash blinded with the factor whose inverse is
+    // blind_factor, i.e. blind_factor^e * blinded_text = message_hash mod N.  Lets the
+    // signer check an opened single block blinding without a private key operation.
+    bool VerifyBlinding(const mpz_class&      blinded_text,
+                        const mpz_class&      message_hash,
+                        const Rsa::PublicKey& public_key,
+                        const mpz_class&      blind_factor);
 }
 
 #endif // BLINDSIGNATURE_H
@@ -0,0 +1,73 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#ifndef KEYPOOL_H
+#define KEYPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Rsa.h"
+
+namespace Rsa
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+    //! Keeps a few ready key pairs of one size.  Low priority threads search for
+    //! primes in the background and top the pool up whenever a key pair is taken,
+    //! so that rotating a key or adding a denomination never waits on keygen.
+    /////////////////////////////////////////////////////////////////////////////////////
+    class KeyPool
+    {
+        public:
+            KeyPool( int num_bits, size_t size, unsigned int num_threads = 1 );
+            ~KeyPool();
+
+            // hands out a ready key pair, waiting for one only if the pool is empty
+            KeyPair Take();
+
+            size_t Available();
+
+        private:
+            KeyPool( const KeyPool& ) = delete;
+            KeyPool& operator=( const KeyPool& ) = delete;
+
+            void Worker();
+
+            const int    num_bits;
+            const size_t size;
+
+            std::mutex              m_mutex;
+            std::condition_variable m_cond;
+            std::deque<KeyPair>     m_ready;
+            // key pairs the workers are generating right now
+            size_t                  m_in_progress = 0;
+            bool                    m_stopping    = false;
+
+            std::vector<std::thread> m_workers;
+    };
+};
+
+#endif // KEYPOOL_H
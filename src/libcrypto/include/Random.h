@@ -24,12 +24,22 @@
 #ifndef RANDOM_H
 #define RANDOM_H
 
+#include <cstddef>
 #include <gmpxx.h>
+#include <string>
+#include <vector>
 
 namespace Random
 {
     mpz_class GenerateRandomNumberBits(unsigned int num_bits);
     mpz_class GenerateRandomNumberRange(const mpz_class& num);
+    // count independent numbers between 1 and num, each from its own bytes of /dev/urandom
+    std::vector<mpz_class> GenerateRandomNumbersRange(const mpz_class& num, size_t count);
+
+    // num_bytes straight from /dev/urandom
+    std::string GenerateRandomBytes(size_t num_bytes);
+    // count distinct numbers drawn uniformly from [0, num), in the order they were drawn
+    std::vector<unsigned int> Sample(unsigned int num, unsigned int count);
 };
 
 #endif // RANDOM_H
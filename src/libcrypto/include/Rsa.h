@@ -28,6 +28,7 @@
 #include <memory>
 #include <string>
 #include <tuple>
+#include <vector>
 
 namespace Rsa
 {
@@ -43,6 +44,24 @@ namespace Rsa
         mpz_class e;
     };
 
+    // the private key split up so that it can be used with the Chinese remainder
+    // theorem, which is about four times faster than using d directly
+    struct CrtKey
+    {
+        mpz_class p;
+        mpz_class q;
+        mpz_class dp;   // d mod (p-1)
+        mpz_class dq;   // d mod (q-1)
+        mpz_class qinv; // q^-1 mod p
+    };
+
+    struct KeyPair
+    {
+        PrivateKey priv;
+        PublicKey  pub;
+        CrtKey     crt;
+    };
+
     mpz_class Encipher(const mpz_class& plain_text,
                        const PublicKey& public_key,
                        const bool       pad);
@@ -54,11 +73,102 @@ namespace Rsa
                    const PrivateKey& private_key,
                    const PublicKey&  public_key,
                    const bool        pad);
+    mpz_class Sign(const mpz_class& plain_text,
+                   const KeyPair&   key_pair,
+                   const bool       pad);
     mpz_class Unsign(const mpz_class& cipher_text,
                      const PublicKey& public_key,
                      const bool       pad);
 
+    // unsign many independent cipher texts at once, spread over the hardware threads
+    std::vector<mpz_class> Unsign(const std::vector<mpz_class>& cipher_texts,
+                                  const PublicKey&              public_key,
+                                  const bool                    pad);
+
+    // Hash-then-sign: the message is hashed onto [0, N) and only the hash is signed,
+    // so a signature is one exponentiation however long the message is.  The hash
+    // stretches SHA-256 to 128 bits more than N and reduces it, which keeps the
+    // result close to uniform.
+    mpz_class FullDomainHash(const std::string& message,
+                             const PublicKey&   public_key);
+
+    // true if signature^e mod N is the full domain hash of the message
+    bool VerifyFullDomainHash(const std::string& message,
+                              const mpz_class&   signature,
+                              const PublicKey&   public_key);
+
+    // many independent messages at once, spread over the hardware threads
+    std::vector<bool> VerifyFullDomainHash(const std::vector<std::string>& messages,
+                                           const std::vector<mpz_class>&   signatures,
+                                           const PublicKey&                public_key);
+
+    // Batch screening: true if (s_1^r_1 * ... * s_n^r_n)^e = h_1^r_1 * ... * h_n^r_n mod N,
+    // which costs one exponentiation by e for the whole batch.  With exponent_bits 0 every
+    // r_i is 1, and a batch that passes shows every message was signed by the key, though
+    // not that each signature is the one for its own message.  Random r_i of exponent_bits
+    // bits also catch that, except with probability 2^-exponent_bits, but then every
+    // coin costs two exponentiations by r_i, which is more than one by a small e.
+    bool ScreenFullDomainHash(const std::vector<std::string>& messages,
+                              const std::vector<mpz_class>&   signatures,
+                              const PublicKey&                public_key,
+                              const unsigned int              exponent_bits = 0);
+
+    // screens the batch and only checks the messages one by one if the screen fails
+    std::vector<bool> BatchVerifyFullDomainHash(const std::vector<std::string>& messages,
+                                                const std::vector<mpz_class>&   signatures,
+                                                const PublicKey&                public_key,
+                                                const unsigned int              exponent_bits = 0);
+
+    // the cipher text as decimal digits, every block the full width of N.  This is the
+    // form BlockStream reads.
+    std::string BlockDigits(const mpz_class& cipher_text,
+                            const PublicKey& public_key);
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    //! Unsigns or deciphers a text a piece at a time, e.g. as it comes off a socket,
+    //! rather than once the whole text is in memory.  Each block is exponentiated as
+    //! soon as its last digit is fed in, so only one block of cipher text is held:
+    //!
+    //!     Rsa::BlockStream stream(pub, true);
+    //!     client.ReadFramedAndAcknowledge([&](const char* digits, size_t length)
+    //!     {
+    //!         stream.Feed(digits, length);
+    //!     });
+    //!     mpz_class plain_text = stream.Finish();
+    //!
+    //! The text has to be in the form BlockDigits gives.
+    /////////////////////////////////////////////////////////////////////////////////////
+    class BlockStream
+    {
+        public:
+            // unsign, with the public key
+            BlockStream(const PublicKey& public_key, const bool pad);
+            // decipher, with the private key
+            BlockStream(const PrivateKey& private_key, const PublicKey& public_key, const bool pad);
+
+            // throws std::invalid_argument if a block is not decimal digits
+            void Feed(const char* digits, size_t length);
+            void Feed(const std::string& digits);
+
+            // the plain text of everything fed in.  Throws std::invalid_argument if
+            // nothing was fed in or the last block is incomplete.
+            mpz_class Finish();
+
+        private:
+            mpz_class   m_key;
+            mpz_class   m_modulus;
+            size_t      m_block_size;
+            bool        m_pad;
+            std::string m_block;
+            std::string m_plain_text;
+    };
+
     std::tuple<PrivateKey, PublicKey> GenerateKeys(int num_bits);
+    KeyPair GenerateKeyPair(int num_bits);
+
+    // key files hold N, e, d and the CRT components as raw GMP numbers
+    void WriteKeyPair(const KeyPair& key_pair, const std::string& filename);
+    bool ReadKeyPair(KeyPair& key_pair, const std::string& filename);
 };
 
 #endif // RSA_H
@@ -26,13 +26,20 @@
 
 #include <gmpxx.h>
 #include <string>
+#include <tuple>
 
 namespace Utilities
 {
     mpz_class StringToNumber(const std::string& str);
     std::string NumberToString(const mpz_class& num);
     mpz_class FastExp(const mpz_class& a, const mpz_class& n, const mpz_class& m);
+    // (g, x, y) with a*x + b*y = g = gcd(a, b)
     std::tuple<mpz_class, mpz_class, mpz_class> ExtendedGcd(const mpz_class& a, const mpz_class& b);
+    // a^-1 mod m into result, false if a has no inverse.  result is written in
+    // place, so a caller inverting many numbers can keep reusing one result.
+    bool ModInverse(mpz_class& result, const mpz_class& a, const mpz_class& m);
+    // the 32 byte SHA-256 digest of data
+    std::string Sha256(const std::string& data);
 };
 
 #endif // UTILITIES_H
@@ -22,9 +22,10 @@
 // 
 
 #include "BitCommitment.h"
-#include <gcrypt.h>
+#include <atomic>
 #include <gmpxx.h>
 #include <iostream>
+#include "Parallel.h"
 #include "Random.h"
 #include <tuple>
 #include "Utilities.h"
@@ -42,27 +43,14 @@ CommitData GenCommitData( mpz_class b )
 
 std::string Hash(const CommitData& c )
 {
-    const int size = gcry_md_get_algo_dlen(GCRY_MD_SHA256);
-    char  digest[size+1];
-
-    if (!gcry_check_version(GCRYPT_VERSION) )
-        exit(-1);
-
-    gcry_control(GCRYCTL_DISABLE_SECMEM, 0);
-    gcry_control(GCRYCTL_INITIALIZATION_FINISHED, 0);
-            
     // Concatenate r1, r2, and b 
     std::string convertedStr = c.r1 + c.r2 + c.b;
 
     // hash the buffer into the digest
-    gcry_md_hash_buffer( GCRY_MD_SHA256, 
-                         reinterpret_cast<void*>(digest),
-                         convertedStr.c_str(),
-                         convertedStr.size() );
-    
-    // return the mpz_class version of digest
-    digest[size] = '\0';
-    return( std::string(digest) );
+    std::string digest = Utilities::Sha256( convertedStr );
+
+    // commitments have always been compared up to the digest's first zero byte
+    return( std::string(digest.c_str()) );
 }
 
 bool Verify( CommitData  receivedCommitData,
@@ -83,3 +71,30 @@ bool Verify( CommitData  receivedCommitData,
     return false;
 }
 
+bool VerifyBatch( const std::vector<CommitData>& receivedCommitData,
+                  const std::vector<CommitPair>& originals )
+{
+    if (receivedCommitData.size() != originals.size())
+    {
+        return false;
+    }
+
+    std::atomic<bool> verified(true);
+
+    Parallel::For(receivedCommitData.size(), [&](size_t i)
+    {
+        if (!verified)
+        {
+            // one failure already decides the batch
+            return;
+        }
+
+        if ( (receivedCommitData[i].r1 != originals[i].second) ||
+             (Hash(receivedCommitData[i]) != originals[i].first) )
+        {
+            verified = false;
+        }
+    });
+
+    return verified;
+}
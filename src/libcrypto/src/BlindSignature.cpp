@@ -22,50 +22,115 @@
 // 
 
 #include "BlindSignature.h"
+#include "Parallel.h"
 #include "Random.h"
 #include "Utilities.h"
 
+#include <algorithm>
 #include <gmpxx.h>
-#include <iostream>
 
 namespace
 {
     const unsigned int BASE = 10;
+
+    // texts with fewer blocks are blinded on the calling thread
+    const size_t PARALLEL_MIN_BLOCKS = 4;
 }
 
-std::tuple<mpz_class, mpz_class> BlindSignature::Blind(const mpz_class&      plain_text,
-                                                       const Rsa::PublicKey& public_key,
-                                                       const bool            pad)
+std::vector<BlindSignature::BlindingFactor> BlindSignature::GenerateBlindingFactors(const Rsa::PublicKey& public_key,
+                                                                                    const size_t          count)
 {
-    // get random number between 1 and N that is coprime with N
-    mpz_class blinding_factor = Random::GenerateRandomNumberRange(public_key.N);
+    const mpz_class& N = public_key.N;
+
+    // random numbers between 1 and N
+    std::vector<mpz_class> k = Random::GenerateRandomNumbersRange(N, count);
+
+    std::vector<BlindingFactor> factors(count);
+    if (count == 0)
+    {
+        return factors;
+    }
+
+    // Montgomery's trick: invert the product of all the k's once, then peel
+    // the individual inverses off it.  prefix[i] = k[0]*...*k[i] mod N
+    std::vector<mpz_class> prefix(count);
+    mpz_class inverse;
     while (true)
     {
-        mpz_class gcd;
-        mpz_class x;
-        mpz_class y;
-        std::tie(gcd, x, y) = Utilities::ExtendedGcd(public_key.N, blinding_factor);
+        prefix[0] = k[0];
+        for (size_t i = 1; i < count; ++i)
+        {
+            mpz_mul(prefix[i].get_mpz_t(), prefix[i-1].get_mpz_t(), k[i].get_mpz_t());
+            mpz_mod(prefix[i].get_mpz_t(), prefix[i].get_mpz_t(), N.get_mpz_t());
+        }
 
-        if (gcd == 1)
+        if (Utilities::ModInverse(inverse, prefix[count-1], N))
         {
             break;
         }
 
-        blinding_factor = Random::GenerateRandomNumberRange(public_key.N);
+        // some k shares a factor with N, draw those again
+        mpz_class gcd;
+        for (auto& k_i : k)
+        {
+            mpz_gcd(gcd.get_mpz_t(), k_i.get_mpz_t(), N.get_mpz_t());
+            while (gcd != 1)
+            {
+                k_i = Random::GenerateRandomNumbersRange(N, 1)[0];
+                mpz_gcd(gcd.get_mpz_t(), k_i.get_mpz_t(), N.get_mpz_t());
+            }
+        }
     }
 
+    for (size_t i = count; i-- > 0; )
+    {
+        // inverse is (k[0]*...*k[i])^-1, so k[i]^-1 = inverse*k[0]*...*k[i-1]
+        if (i > 0)
+        {
+            mpz_mul(factors[i].k_inv.get_mpz_t(), inverse.get_mpz_t(), prefix[i-1].get_mpz_t());
+            mpz_mod(factors[i].k_inv.get_mpz_t(), factors[i].k_inv.get_mpz_t(), N.get_mpz_t());
+
+            mpz_mul(inverse.get_mpz_t(), inverse.get_mpz_t(), k[i].get_mpz_t());
+            mpz_mod(inverse.get_mpz_t(), inverse.get_mpz_t(), N.get_mpz_t());
+        }
+        else
+        {
+            factors[i].k_inv = inverse;
+        }
+
+        mpz_powm(factors[i].k_e.get_mpz_t(), k[i].get_mpz_t(), public_key.e.get_mpz_t(), N.get_mpz_t());
+    }
+
+    return factors;
+}
+
+std::tuple<mpz_class, mpz_class> BlindSignature::Blind(const mpz_class&      plain_text,
+                                                       const Rsa::PublicKey& public_key,
+                                                       const bool            pad)
+{
+    return Blind(plain_text, public_key, GenerateBlindingFactors(public_key, 1)[0], pad);
+}
+
+std::tuple<mpz_class, mpz_class> BlindSignature::Blind(const mpz_class&      plain_text,
+                                                       const Rsa::PublicKey& public_key,
+                                                       const BlindingFactor& blinding_factor,
+                                                       const bool            pad)
+{
     size_t modulus_size = mpz_sizeinbase(public_key.N.get_mpz_t(), BASE);
     size_t block_size = pad ? (modulus_size - 3) : modulus_size;
 
     const std::string pt_str = plain_text.get_str(BASE);
-    std::string bt_str = "";
 
-    // compute k^e
-    mpz_class k_e = Utilities::FastExp(blinding_factor, public_key.e, public_key.N);
+    const mpz_class& k_e = blinding_factor.k_e;
 
-    for (size_t i = 0; i < pt_str.size(); i += block_size)
+    // every blinded block is as many digits as N, so each has a fixed slot
+    const size_t num_blocks = (pt_str.size() + block_size - 1) / block_size;
+    std::string bt_str(num_blocks * modulus_size, '0');
+    char* bt_slots = &bt_str[0];
+
+    Parallel::For(num_blocks, [&](size_t i)
     {
-        std::string block_str = pt_str.substr(i, block_size);
+        std::string block_str = pt_str.substr(i * block_size, block_size);
 
         if (pad)
         {
@@ -85,35 +150,15 @@ std::tuple<mpz_class, mpz_class> BlindSignature::Blind(const mpz_class&      pla
         mpz_class bt_block_z = block_z*k_e;
         mpz_mod(bt_block_z.get_mpz_t(), bt_block_z.get_mpz_t(), public_key.N.get_mpz_t());
 
+        // the slot is zero filled, the block goes at its right end
         std::string bt_block_str = bt_block_z.get_str(BASE);
-        while (bt_block_str.size() < modulus_size)
-        {
-            // prepend with 0
-            bt_block_str.insert(0, 1, '0');
-        }
-
-        bt_str += bt_block_str;
-    }
+        std::copy(bt_block_str.begin(), bt_block_str.end(), bt_slots + (i + 1) * modulus_size - bt_block_str.size());
+    }, PARALLEL_MIN_BLOCKS);
 
     // now make it one big number
     mpz_class blind_text(bt_str, BASE);
 
-    // find mult. mod. inverse of blinding_factor
-    // N*x + blind_factor*y = gcd(N, blind_factor)
-    mpz_class gcd;
-    mpz_class x;
-    mpz_class y;
-    std::tie(gcd, x, y) = Utilities::ExtendedGcd(public_key.N, blinding_factor);
-
-    if (gcd != 1)
-    {
-        std::cerr << "The blinding factor is not coprime with N" << std::endl;
-    }
-
-    // reduce mod N
-    mpz_mod(y.get_mpz_t(), y.get_mpz_t(), public_key.N.get_mpz_t());
-
-    return std::make_tuple(blind_text, y);
+    return std::make_tuple(blind_text, blinding_factor.k_inv);
 }
 
 mpz_class BlindSignature::Unblind(const mpz_class&      blinded_text,
@@ -123,18 +168,17 @@ mpz_class BlindSignature::Unblind(const mpz_class&      blinded_text,
 {
     size_t block_size = mpz_sizeinbase(public_key.N.get_mpz_t(), BASE);
     std::string bt_str = blinded_text.get_str(BASE);
-    std::string pt_str = "";
 
     // we need to make sure that the blinded text coming in is padded correctly
-    while ((bt_str.size() % block_size) != 0)
-    {
-        // prepend with 0
-        bt_str.insert(0, 1, '0');
-    }
+    bt_str.insert(0, (block_size - bt_str.size() % block_size) % block_size, '0');
+
+    // with the padding stripped blocks differ in length, so each gets its own slot
+    const size_t num_blocks = bt_str.size() / block_size;
+    std::vector<std::string> pt_blocks(num_blocks);
 
-    for (size_t i = 0; i < bt_str.size(); i += block_size)
+    Parallel::For(num_blocks, [&](size_t i)
     {
-        std::string block_str = bt_str.substr(i, block_size);
+        std::string block_str = bt_str.substr(i * block_size, block_size);
 
         // calculate plain text block and reduce mod N
         mpz_class block_z(block_str, BASE);
@@ -150,14 +194,16 @@ mpz_class BlindSignature::Unblind(const mpz_class&      blinded_text,
         else
         {
             // if this is not the end of the chain, then we want to pad it back out to size of N
-            while (pt_block_str.size() < block_size)
-            {
-                // prepend with 0
-                pt_block_str.insert(0, 1, '0');
-            }
+            pt_block_str.insert(0, block_size - std::min(block_size, pt_block_str.size()), '0');
         }
 
-        // append each plain text block to the overall plain text string
+        pt_blocks[i].swap(pt_block_str);
+    }, PARALLEL_MIN_BLOCKS);
+
+    std::string pt_str;
+    pt_str.reserve(num_blocks * block_size);
+    for (const auto& pt_block_str : pt_blocks)
+    {
         pt_str += pt_block_str;
     }
 
@@ -166,3 +212,19 @@ mpz_class BlindSignature::Unblind(const mpz_class&      blinded_text,
 
     return plain_text;
 }
+
+bool BlindSignature::VerifyBlinding(const mpz_class&      blinded_text,
+                                    const mpz_class&      message_hash,
+                                    const Rsa::PublicKey& public_key,
+                                    const mpz_class&      blind_factor)
+{
+    const mpz_class& N = public_key.N;
+
+    // blind_factor is k^-1, so (k^-1)^e * m*k^e = m
+    mpz_class unblinded;
+    mpz_powm(unblinded.get_mpz_t(), blind_factor.get_mpz_t(), public_key.e.get_mpz_t(), N.get_mpz_t());
+    mpz_mul(unblinded.get_mpz_t(), unblinded.get_mpz_t(), blinded_text.get_mpz_t());
+    mpz_mod(unblinded.get_mpz_t(), unblinded.get_mpz_t(), N.get_mpz_t());
+
+    return unblinded == message_hash;
+}
@@ -0,0 +1,104 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#include "KeyPool.h"
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+    // nice value for the keygen threads, the request path always wins
+    const int KEYGEN_NICE = 19;
+}
+
+Rsa::KeyPool::KeyPool( int num_bits, size_t size, unsigned int num_threads )
+    : num_bits( num_bits ),
+      size( size )
+{
+    for (unsigned int i = 0; i < num_threads; ++i)
+    {
+        m_workers.push_back( std::thread(&KeyPool::Worker, this) );
+    }
+}
+
+Rsa::KeyPool::~KeyPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+
+    // a worker in the middle of a prime search finishes it first
+    m_cond.notify_all();
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+Rsa::KeyPair Rsa::KeyPool::Take()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait(lock, [this]{ return !m_ready.empty(); });
+
+    KeyPair key_pair = m_ready.front();
+    m_ready.pop_front();
+
+    // let a worker start on the replacement
+    m_cond.notify_all();
+
+    return key_pair;
+}
+
+size_t Rsa::KeyPool::Available()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_ready.size();
+}
+
+void Rsa::KeyPool::Worker()
+{
+    // on Linux the nice value belongs to the thread, not the whole process
+    setpriority(PRIO_PROCESS, syscall(SYS_gettid), KEYGEN_NICE);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_cond.wait(lock, [this]{ return m_stopping || m_ready.size() + m_in_progress < size; });
+        if (m_stopping)
+        {
+            break;
+        }
+
+        ++m_in_progress;
+        lock.unlock();
+        KeyPair key_pair = GenerateKeyPair(num_bits);
+        lock.lock();
+        --m_in_progress;
+
+        m_ready.push_back(key_pair);
+        m_cond.notify_all();
+    }
+}
@@ -0,0 +1,101 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // set on the threads running a For, so that a nested For does not start more
+    thread_local bool in_parallel_for = false;
+}
+
+unsigned int Parallel::NumThreads()
+{
+    unsigned int num_threads = std::thread::hardware_concurrency();
+    return (num_threads == 0) ? 1 : num_threads;
+}
+
+void Parallel::For(size_t count, const std::function<void(size_t)>& func, size_t min_count)
+{
+    size_t num_threads = std::min<size_t>(NumThreads(), count);
+    if (count < min_count || in_parallel_for)
+    {
+        num_threads = 1;
+    }
+
+    // only a For that really spreads out keeps the ones inside it on their threads
+    const bool spread = (num_threads > 1);
+
+    std::atomic<size_t> next(0);
+    std::exception_ptr  error;
+    std::mutex          error_mutex;
+
+    auto worker = [&]()
+    {
+        const bool nested = in_parallel_for;
+        in_parallel_for |= spread;
+
+        for (size_t i = next++; i < count; i = next++)
+        {
+            try
+            {
+                func(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+        }
+
+        in_parallel_for = nested;
+    };
+
+    // the calling thread does its share of the work too
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < num_threads; ++t)
+    {
+        threads.push_back(std::thread(worker));
+    }
+    worker();
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
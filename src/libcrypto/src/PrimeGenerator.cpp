@@ -24,15 +24,111 @@
 #include "PrimeGenerator.h"
 #include "Random.h"
 
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+    // candidates are sieved against every odd prime below this bound
+    const unsigned long SMALL_PRIME_LIMIT = 65536;
+
+    // Documentation says that 25 tests will allow a
+    // composite to be returned as prime with proba-
+    // bility less than 2^(-50)
+    const int MILLER_RABIN_REPS = 25;
+
+    // below this size the candidates could be small primes themselves
+    const int MIN_SIEVE_BITS = 32;
+
+    const std::vector<unsigned long>& SmallPrimes()
+    {
+        static const std::vector<unsigned long> primes = []()
+        {
+            std::vector<bool> composite(SMALL_PRIME_LIMIT, false);
+            std::vector<unsigned long> found;
+            for (unsigned long i = 3; i < SMALL_PRIME_LIMIT; i += 2)
+            {
+                if (!composite[i])
+                {
+                    found.push_back(i);
+                    for (unsigned long j = i*i; j < SMALL_PRIME_LIMIT; j += 2*i)
+                    {
+                        composite[j] = true;
+                    }
+                }
+            }
+            return found;
+        }();
+
+        return primes;
+    }
+}
+
 /////////////////////////////////////////////////////////////////////////////////////
 //! Returns a prime number that is at least num_bits long
+//!
+//! Starting from a random odd number, the odd numbers in a window are sieved
+//! against a table of small primes, and only the survivors get a Miller-Rabin
+//! test.  When a window runs dry the residues are moved on to the next window
+//! rather than being computed again.
 /////////////////////////////////////////////////////////////////////////////////////
 mpz_class PrimeGenerator::GetPrimeNumber(int num_bits)
 {
     mpz_class random = Random::GenerateRandomNumberBits(num_bits);
 
-    mpz_class prime;
-    mpz_nextprime(prime.get_mpz_t(), random.get_mpz_t());
-    
-    return mpz_class(prime);
+    if (num_bits < MIN_SIEVE_BITS)
+    {
+        mpz_class prime;
+        mpz_nextprime(prime.get_mpz_t(), random.get_mpz_t());
+        return prime;
+    }
+
+    // the window holds the odd numbers base, base + 2, base + 4, ...
+    mpz_class base = random;
+    mpz_setbit(base.get_mpz_t(), 0);
+    const unsigned long window = 2*num_bits;
+
+    const std::vector<unsigned long>& primes = SmallPrimes();
+    std::vector<unsigned long> residues(primes.size());
+    for (size_t i = 0; i < primes.size(); ++i)
+    {
+        residues[i] = mpz_fdiv_ui(base.get_mpz_t(), primes[i]);
+    }
+
+    std::vector<bool> composite(window);
+    mpz_class candidate;
+    while (true)
+    {
+        std::fill(composite.begin(), composite.end(), false);
+
+        for (size_t i = 0; i < primes.size(); ++i)
+        {
+            // base + 2k is divisible by p when k = -base/2 mod p
+            const unsigned long p = primes[i];
+            unsigned long k = ((p - residues[i]) % p) * ((p + 1)/2) % p;
+            for (; k < window; k += p)
+            {
+                composite[k] = true;
+            }
+        }
+
+        for (unsigned long k = 0; k < window; ++k)
+        {
+            if (!composite[k])
+            {
+                candidate = base + 2*k;
+                if (mpz_probab_prime_p(candidate.get_mpz_t(), MILLER_RABIN_REPS) > 0)
+                {
+                    return candidate;
+                }
+            }
+        }
+
+        // slide on to the next window
+        base += 2*window;
+        for (size_t i = 0; i < primes.size(); ++i)
+        {
+            residues[i] = (residues[i] + 2*window) % primes[i];
+        }
+    }
 }
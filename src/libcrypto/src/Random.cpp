@@ -23,26 +23,50 @@
 
 #include "Random.h"
 
+#include <algorithm>
 #include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+    // the shortest seed GenerateRandomNumberBits takes from /dev/urandom
+    const size_t MIN_SEED_BYTES = 16;
+
+    // the bytes GenerateRandomNumbersRange draws beyond the size of the range
+    const size_t EXTRA_BYTES = 16;
+
+    // a seed made from a full 256 bits of /dev/urandom
+    mpz_class UrandomSeed()
+    {
+        const unsigned int num_bytes = 32;
+        char block[num_bytes];
+        std::ifstream urandom("/dev/urandom", std::ios::in|std::ios::binary);
+        urandom.read(block, num_bytes);
+        urandom.close();
+
+        mpz_class seed;
+        mpz_import(seed.get_mpz_t(), num_bytes, 1, sizeof(block[0]), 1, 0, block);
+
+        return seed;
+    }
+}
 
 mpz_class Random::GenerateRandomNumberBits(unsigned int num_bits)
 {
-    // Get a random seed
-    uint16_t num_bytes = num_bits/4; 
-    char block[num_bytes]; 
-    std::ifstream urandom("/dev/urandom", std::ios::in|std::ios::binary); 
-    urandom.read(block, num_bytes - 1);  // subtract one for null terminater
-    urandom.close();
+    // Get a random seed, never shorter than MIN_SEED_BYTES however few bits are wanted
+    const std::string block = GenerateRandomBytes(std::max<size_t>(MIN_SEED_BYTES, (num_bits + 7) / 8));
 
     // turn those random bits into a large number "seed"
     mpz_class seed;
     mpz_import(seed.get_mpz_t(),
-               sizeof(block),
+               block.size(),
                1,  // MSW first
                sizeof(block[0]),
                1,  // big endian
                0,  // use the full word
-               block);
+               block.data());
 
     // generate a larger number
     gmp_randclass rand_gen(gmp_randinit_default);
@@ -60,6 +84,19 @@ mpz_class Random::GenerateRandomNumberBits(unsigned int num_bits)
     return random_z;
 }
 
+std::string Random::GenerateRandomBytes(size_t num_bytes)
+{
+    std::string bytes(num_bytes, '\0');
+    std::ifstream urandom("/dev/urandom", std::ios::in|std::ios::binary);
+    urandom.read(&bytes[0], num_bytes);
+    if (!urandom)
+    {
+        throw std::runtime_error("GenerateRandomBytes(): unable to read /dev/urandom");
+    }
+
+    return bytes;
+}
+
 mpz_class Random::GenerateRandomNumberRange(const mpz_class& num)
 {
     // Get a random seed
@@ -87,3 +124,48 @@ mpz_class Random::GenerateRandomNumberRange(const mpz_class& num)
     // get_z_range returns a value between 0 and n-1, so add 1 to it here
     return (random_z + 1);
 }
+
+std::vector<mpz_class> Random::GenerateRandomNumbersRange(const mpz_class& num, size_t count)
+{
+    // these are secrets, blinding factors among them, and a buyer hands the bank most of
+    // a withdrawal's: no number may follow from the others, as they would from one
+    // generator's stream.  Each gets its own bytes of /dev/urandom, EXTRA_BYTES more
+    // than num needs so that reducing them is as good as uniform.
+    const size_t num_bytes = (mpz_sizeinbase(num.get_mpz_t(), 2) + 7) / 8 + EXTRA_BYTES;
+    const std::string bytes = GenerateRandomBytes(num_bytes * count);
+
+    std::vector<mpz_class> numbers(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        mpz_import(numbers[i].get_mpz_t(), num_bytes, 1, 1, 1, 0, bytes.data() + i*num_bytes);
+
+        // reduced to a value between 0 and n-1, so add 1 to it here
+        mpz_mod(numbers[i].get_mpz_t(), numbers[i].get_mpz_t(), num.get_mpz_t());
+        numbers[i] += 1;
+    }
+
+    return numbers;
+}
+
+std::vector<unsigned int> Random::Sample(unsigned int num, unsigned int count)
+{
+    if (count > num)
+    {
+        throw std::invalid_argument("Sample(): count is larger than the range");
+    }
+
+    gmp_randclass rand_gen(gmp_randinit_default);
+    rand_gen.seed(UrandomSeed());
+
+    // the first count steps of a Fisher-Yates shuffle
+    std::vector<unsigned int> numbers(num);
+    std::iota(numbers.begin(), numbers.end(), 0);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        mpz_class j = rand_gen.get_z_range(num - i);
+        std::swap(numbers[i], numbers[i + j.get_ui()]);
+    }
+
+    numbers.resize(count);
+    return numbers;
+}
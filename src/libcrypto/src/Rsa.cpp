@@ -22,42 +22,63 @@
 // 
 
 #include "Rsa.h"
+#include "Parallel.h"
 #include "PrimeGenerator.h"
+#include "Random.h"
 #include "Utilities.h"
 
 #include <gmpxx.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <future>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <iostream>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 namespace
 {
     const unsigned int BASE = 10;
 
+    // bits the full domain hash draws beyond the size of N before reducing
+    const size_t FDH_EXTRA_BITS = 128;
+
+    // messages with fewer blocks are exponentiated on the calling thread
+    const size_t PARALLEL_MIN_BLOCKS = 4;
+
+    // raises one block to the key, modulo the modulus
+    typedef std::function<mpz_class(const mpz_class&)> BlockExp;
+
     mpz_class EncipherSignBlocks(const mpz_class& plain_text,
-                                 const mpz_class& key,
+                                 const BlockExp&  block_exp,
                                  const mpz_class& modulus,
                                  const bool       pad)
     {
         size_t modulus_size = mpz_sizeinbase(modulus.get_mpz_t(), BASE);
         size_t block_size = pad ? (modulus_size - 3) : modulus_size;
         std::string pt_str = plain_text.get_str(BASE);
-        std::string ct_str = "";
 
         if (!pad)
         {
             // we need to make sure that the text coming in is a multiple of the modulus size
             // in case we've lost some zeros off of the front
-            while ((pt_str.size() % modulus_size) != 0)
-            {
-                // prepend with 0
-                pt_str.insert(0, 1, '0');
-            }
+            pt_str.insert(0, (modulus_size - pt_str.size() % modulus_size) % modulus_size, '0');
         }
 
-        for (size_t i = 0; i < pt_str.size(); i += block_size)
+        // every cipher text block has exactly as many digits as N, so each block's
+        // slot in the cipher text is known before any of them is computed
+        const size_t num_blocks = (pt_str.size() + block_size - 1) / block_size;
+        std::string ct_str(num_blocks * modulus_size, '0');
+        char* ct_slots = &ct_str[0];
+
+        Parallel::For(num_blocks, [&](size_t i)
         {
-            std::string block_str = pt_str.substr(i, block_size);
+            std::string block_str = pt_str.substr(i * block_size, block_size);
 
             if (pad)
             {
@@ -75,17 +96,11 @@ namespace
 
             // based on this paper: http://ocw.upc.edu/sites/default/files/materials/15012145/36492-3048.pdf
             // we want to add leading zeros onto our cipher text blocks to fill them out to a size of the same
-            // number of digits as N.  See section 1.1.3, 1.1.4.
-            std::string ct_block_str = Utilities::FastExp(block_z, key, modulus).get_str(BASE);
-            while (ct_block_str.size() < modulus_size)
-            {
-                // prepend with 0
-                ct_block_str.insert(0, 1, '0');
-            }
-
-            // append each cipher text block to the overall cipher text string
-            ct_str += ct_block_str;
-        }
+            // number of digits as N.  See section 1.1.3, 1.1.4.  The slot is already zero filled, so the
+            // block goes at its right end.
+            std::string ct_block_str = block_exp(block_z).get_str(BASE);
+            std::copy(ct_block_str.begin(), ct_block_str.end(), ct_slots + (i + 1) * modulus_size - ct_block_str.size());
+        }, PARALLEL_MIN_BLOCKS);
 
         // now make it one big number
         mpz_class cipher_text(ct_str, BASE);
@@ -93,8 +108,29 @@ namespace
         return cipher_text;
     }
 
+    // one exponentiated cipher text block as plain text digits
+    std::string PlainBlock(const mpz_class& pt_block_z,
+                           const size_t     block_size,
+                           const bool       pad)
+    {
+        std::string pt_block_str = pt_block_z.get_str(BASE);
+
+        if (pad)
+        {
+            //strip off the 0111...0 padding
+            pt_block_str.erase(0, pt_block_str.find_first_of('0', 1) + 1);
+        }
+        else
+        {
+            // if this is not the end of the chain, then we want to pad it back out to size of N
+            pt_block_str.insert(0, block_size - std::min(block_size, pt_block_str.size()), '0');
+        }
+
+        return pt_block_str;
+    }
+
     mpz_class DecipherUnsignBlocks(const mpz_class& cipher_text,
-                                   const mpz_class& key,
+                                   const BlockExp&  block_exp,
                                    const mpz_class& modulus,
                                    const bool       pad)
     {
@@ -102,37 +138,25 @@ namespace
         std::string ct_str = cipher_text.get_str(BASE);
 
         // we need to make sure that the text coming in is padded correctly
-        while ((ct_str.size() % block_size) != 0)
-        {
-            // prepend with 0
-            ct_str.insert(0, 1, '0');
-        }
+        ct_str.insert(0, (block_size - ct_str.size() % block_size) % block_size, '0');
 
-        std::string pt_str = "";
+        // stripping the padding leaves blocks of different lengths, so each block is
+        // decoded into its own slot and the slots are joined once all are done
+        const size_t num_blocks = ct_str.size() / block_size;
+        std::vector<std::string> pt_blocks(num_blocks);
 
-        for (size_t i = 0; i < ct_str.size(); i += block_size)
+        Parallel::For(num_blocks, [&](size_t i)
         {
-            std::string block_str = ct_str.substr(i, block_size);
+            std::string block_str = ct_str.substr(i * block_size, block_size);
             mpz_class block_z(block_str, BASE);
 
-            std::string pt_block_str = Utilities::FastExp(block_z, key, modulus).get_str(BASE);
+            pt_blocks[i] = PlainBlock(block_exp(block_z), block_size, pad);
+        }, PARALLEL_MIN_BLOCKS);
 
-            if (pad)
-            {
-                //strip off the 0111...0 padding
-                pt_block_str.erase(0, pt_block_str.find_first_of('0', 1) + 1);
-            }
-            else
-            {
-                // if this is not the end of the chain, then we want to pad it back out to size of N
-                while (pt_block_str.size() < block_size)
-                {
-                    // prepend with 0
-                    pt_block_str.insert(0, 1, '0');
-                }
-            }
-
-            // append each cipher text block to the overall plain text string
+        std::string pt_str;
+        pt_str.reserve(num_blocks * block_size);
+        for (const auto& pt_block_str : pt_blocks)
+        {
             pt_str += pt_block_str;
         }
 
@@ -141,13 +165,36 @@ namespace
 
         return plain_text;
     }
+
+    BlockExp Exp(const mpz_class& key, const mpz_class& modulus)
+    {
+        return [&key, &modulus](const mpz_class& block)
+        {
+            return Utilities::FastExp(block, key, modulus);
+        };
+    }
+
+    // c^d mod N, computed mod p and mod q and recombined with Garner's formula
+    BlockExp CrtExp(const Rsa::CrtKey& crt)
+    {
+        return [&crt](const mpz_class& block)
+        {
+            mpz_class m1 = Utilities::FastExp(block % crt.p, crt.dp, crt.p);
+            mpz_class m2 = Utilities::FastExp(block % crt.q, crt.dq, crt.q);
+
+            mpz_class h = crt.qinv*(m1 - m2);
+            mpz_mod(h.get_mpz_t(), h.get_mpz_t(), crt.p.get_mpz_t());
+
+            return mpz_class(m2 + h*crt.q);
+        };
+    }
 }
 
 mpz_class Rsa::Encipher(const mpz_class& plain_text,
                         const PublicKey& public_key,
                         const bool       pad)
 {       
-    return EncipherSignBlocks(plain_text, public_key.e, public_key.N, pad);
+    return EncipherSignBlocks(plain_text, Exp(public_key.e, public_key.N), public_key.N, pad);
 }
 
 mpz_class Rsa::Decipher(const mpz_class&  cipher_text,
@@ -155,7 +202,7 @@ mpz_class Rsa::Decipher(const mpz_class&  cipher_text,
                         const PublicKey&  public_key,
                         const bool        pad)
 {
-    return DecipherUnsignBlocks(cipher_text, private_key, public_key.N, pad);
+    return DecipherUnsignBlocks(cipher_text, Exp(private_key, public_key.N), public_key.N, pad);
 }
 
 mpz_class Rsa::Sign(const mpz_class&  plain_text,
@@ -163,37 +210,352 @@ mpz_class Rsa::Sign(const mpz_class&  plain_text,
                     const PublicKey&  public_key,
                     const bool        pad)
 {
-    return EncipherSignBlocks(plain_text, private_key, public_key.N, pad);
+    return EncipherSignBlocks(plain_text, Exp(private_key, public_key.N), public_key.N, pad);
+}
+
+mpz_class Rsa::Sign(const mpz_class& plain_text,
+                    const KeyPair&   key_pair,
+                    const bool       pad)
+{
+    if (key_pair.crt.p == 0)
+    {
+        // no CRT components, fall back to d
+        return Sign(plain_text, key_pair.priv, key_pair.pub, pad);
+    }
+
+    return EncipherSignBlocks(plain_text, CrtExp(key_pair.crt), key_pair.pub.N, pad);
 }
 
 mpz_class Rsa::Unsign(const mpz_class& cipher_text,
                       const PublicKey& public_key,
                       const bool       pad)
 {
-    return DecipherUnsignBlocks(cipher_text, public_key.e, public_key.N, pad);
+    return DecipherUnsignBlocks(cipher_text, Exp(public_key.e, public_key.N), public_key.N, pad);
+}
+
+std::vector<mpz_class> Rsa::Unsign(const std::vector<mpz_class>& cipher_texts,
+                                   const PublicKey&              public_key,
+                                   const bool                    pad)
+{
+    std::vector<mpz_class> plain_texts(cipher_texts.size());
+
+    Parallel::For(cipher_texts.size(), [&](size_t i)
+    {
+        plain_texts[i] = DecipherUnsignBlocks(cipher_texts[i], Exp(public_key.e, public_key.N), public_key.N, pad);
+    });
+
+    return plain_texts;
+}
+
+mpz_class Rsa::FullDomainHash(const std::string& message,
+                              const PublicKey&   public_key)
+{
+    const size_t num_bytes = (mpz_sizeinbase(public_key.N.get_mpz_t(), 2) + FDH_EXTRA_BITS + 7) / 8;
+
+    // digest = SHA-256(message), then SHA-256(digest || counter) for counter = 0, 1, ...
+    // until there are enough bytes
+    const std::string digest = Utilities::Sha256(message);
+    std::string stretched;
+    for (uint32_t counter = 0; stretched.size() < num_bytes; ++counter)
+    {
+        const char counter_bytes[] = { static_cast<char>(counter >> 24), static_cast<char>(counter >> 16),
+                                       static_cast<char>(counter >> 8),  static_cast<char>(counter) };
+        stretched += Utilities::Sha256(digest + std::string(counter_bytes, sizeof(counter_bytes)));
+    }
+
+    mpz_class hash;
+    mpz_import(hash.get_mpz_t(), num_bytes, 1, 1, 1, 0, stretched.data());
+    mpz_mod(hash.get_mpz_t(), hash.get_mpz_t(), public_key.N.get_mpz_t());
+
+    return hash;
+}
+
+bool Rsa::VerifyFullDomainHash(const std::string& message,
+                               const mpz_class&   signature,
+                               const PublicKey&   public_key)
+{
+    // only the canonical representative verifies, so a coin has one signature
+    if (signature < 0 || signature >= public_key.N)
+    {
+        return false;
+    }
+
+    return Utilities::FastExp(signature, public_key.e, public_key.N) == FullDomainHash(message, public_key);
+}
+
+std::vector<bool> Rsa::VerifyFullDomainHash(const std::vector<std::string>& messages,
+                                            const std::vector<mpz_class>&   signatures,
+                                            const PublicKey&                public_key)
+{
+    if (messages.size() != signatures.size())
+    {
+        throw std::invalid_argument("Rsa::VerifyFullDomainHash needs one signature per message");
+    }
+
+    // vector<bool> packs its elements into shared words, so the threads write chars
+    std::vector<char> valid(messages.size());
+
+    Parallel::For(messages.size(), [&](size_t i)
+    {
+        valid[i] = VerifyFullDomainHash(messages[i], signatures[i], public_key);
+    });
+
+    return std::vector<bool>(valid.begin(), valid.end());
+}
+
+bool Rsa::ScreenFullDomainHash(const std::vector<std::string>& messages,
+                               const std::vector<mpz_class>&   signatures,
+                               const PublicKey&                public_key,
+                               const unsigned int              exponent_bits)
+{
+    if (messages.size() != signatures.size())
+    {
+        throw std::invalid_argument("Rsa::ScreenFullDomainHash needs one signature per message");
+    }
+
+    const size_t     count = messages.size();
+    const mpz_class& N     = public_key.N;
+
+    for (const auto& signature : signatures)
+    {
+        // a zero would make the products say nothing about the other signatures
+        if (signature <= 0 || signature >= N)
+        {
+            return false;
+        }
+    }
+
+    // hashing long money orders is most of the work, the products are cheap
+    std::vector<mpz_class> hashes(count);
+    Parallel::For(count, [&](size_t i)
+    {
+        hashes[i] = FullDomainHash(messages[i], public_key);
+    });
+
+    // r_i in [1, 2^exponent_bits], never 0 so that no message drops out of the test
+    std::vector<mpz_class> exponents;
+    if (exponent_bits > 0)
+    {
+        exponents = Random::GenerateRandomNumbersRange(mpz_class(1) << exponent_bits, count);
+    }
+
+    mpz_class signature_product = 1;
+    mpz_class hash_product      = 1;
+    mpz_class term;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (exponents.empty())
+        {
+            signature_product *= signatures[i];
+            hash_product      *= hashes[i];
+        }
+        else
+        {
+            mpz_powm(term.get_mpz_t(), signatures[i].get_mpz_t(), exponents[i].get_mpz_t(), N.get_mpz_t());
+            signature_product *= term;
+            mpz_powm(term.get_mpz_t(), hashes[i].get_mpz_t(), exponents[i].get_mpz_t(), N.get_mpz_t());
+            hash_product      *= term;
+        }
+
+        mpz_mod(signature_product.get_mpz_t(), signature_product.get_mpz_t(), N.get_mpz_t());
+        mpz_mod(hash_product.get_mpz_t(), hash_product.get_mpz_t(), N.get_mpz_t());
+    }
+
+    return Utilities::FastExp(signature_product, public_key.e, N) == hash_product;
+}
+
+std::vector<bool> Rsa::BatchVerifyFullDomainHash(const std::vector<std::string>& messages,
+                                                 const std::vector<mpz_class>&   signatures,
+                                                 const PublicKey&                public_key,
+                                                 const unsigned int              exponent_bits)
+{
+    if (ScreenFullDomainHash(messages, signatures, public_key, exponent_bits))
+    {
+        return std::vector<bool>(messages.size(), true);
+    }
+
+    // something in the batch is bad, find out which
+    return VerifyFullDomainHash(messages, signatures, public_key);
+}
+
+std::string Rsa::BlockDigits(const mpz_class& cipher_text,
+                             const PublicKey& public_key)
+{
+    size_t block_size = mpz_sizeinbase(public_key.N.get_mpz_t(), BASE);
+    std::string ct_str = cipher_text.get_str(BASE);
+
+    // put back the zeros the first block lost when the blocks became one number
+    ct_str.insert(0, (block_size - ct_str.size() % block_size) % block_size, '0');
+
+    return ct_str;
+}
+
+Rsa::BlockStream::BlockStream(const PublicKey& public_key,
+                              const bool       pad)
+    : m_key( public_key.e ),
+      m_modulus( public_key.N ),
+      m_block_size( mpz_sizeinbase(public_key.N.get_mpz_t(), BASE) ),
+      m_pad( pad )
+{
+    m_block.reserve(m_block_size);
+}
+
+Rsa::BlockStream::BlockStream(const PrivateKey& private_key,
+                              const PublicKey&  public_key,
+                              const bool        pad)
+    : m_key( private_key ),
+      m_modulus( public_key.N ),
+      m_block_size( mpz_sizeinbase(public_key.N.get_mpz_t(), BASE) ),
+      m_pad( pad )
+{
+    m_block.reserve(m_block_size);
+}
+
+void Rsa::BlockStream::Feed(const char* digits, size_t length)
+{
+    while (length > 0)
+    {
+        size_t take = std::min(length, m_block_size - m_block.size());
+        m_block.append(digits, take);
+        digits += take;
+        length -= take;
+
+        if (m_block.size() == m_block_size)
+        {
+            mpz_class block_z(m_block, BASE);
+            m_plain_text += PlainBlock(Utilities::FastExp(block_z, m_key, m_modulus), m_block_size, m_pad);
+            m_block.clear();
+        }
+    }
+}
+
+void Rsa::BlockStream::Feed(const std::string& digits)
+{
+    Feed(digits.data(), digits.size());
+}
+
+mpz_class Rsa::BlockStream::Finish()
+{
+    if (!m_block.empty() || m_plain_text.empty())
+    {
+        throw std::invalid_argument("Rsa::BlockStream did not get whole blocks");
+    }
+
+    mpz_class plain_text(m_plain_text, BASE);
+    m_plain_text.clear();
+
+    return plain_text;
 }
 
 std::tuple<Rsa::PrivateKey, Rsa::PublicKey> Rsa::GenerateKeys(int num_bits)
 {
-    mpz_class p = PrimeGenerator::GetPrimeNumber(num_bits);
-    mpz_class q = PrimeGenerator::GetPrimeNumber(num_bits);
+    KeyPair key_pair = GenerateKeyPair(num_bits);
 
-    mpz_class n = p*q;
-    mpz_class phi = (p-1)*(q-1);
+    return std::make_tuple(key_pair.priv, key_pair.pub);
+}
 
+Rsa::KeyPair Rsa::GenerateKeyPair(int num_bits)
+{
     //http://crypto.stackexchange.com/questions/13166/method-to-calculating-e-in-rsa
     // Use the largest known Fermat number (see wiki page and above article).
     mpz_class e = 65537;
 
-    // phi(n)*x + e*y = gcd(phi(n), e)
-    mpz_class gcd;
-    mpz_class x;
-    mpz_class y;
-    std::tie(gcd, x, y) = Utilities::ExtendedGcd(phi, e);
+    mpz_class p;
+    mpz_class q;
+    mpz_class phi;
+    do
+    {
+        // look for q on another thread while this one looks for p
+        std::future<mpz_class> q_future = std::async(std::launch::async, PrimeGenerator::GetPrimeNumber, num_bits);
+        p = PrimeGenerator::GetPrimeNumber(num_bits);
+        q = q_future.get();
+
+        phi = (p-1)*(q-1);
+    }
+    // e has to be invertible mod phi(n)
+    while (p == q || mpz_fdiv_ui(phi.get_mpz_t(), e.get_ui()) == 0);
+
+    mpz_class n = p*q;
 
-    // reduce y modulo phi
-    mpz_mod(y.get_mpz_t(), y.get_mpz_t(), phi.get_mpz_t());
+    KeyPair key_pair;
+    key_pair.pub = PublicKey(n, e);
 
-    return std::make_tuple(Rsa::PrivateKey(y), Rsa::PublicKey(n, e));
+    // d = e^-1 mod phi(n)
+    Utilities::ModInverse(key_pair.priv, e, phi);
+    const mpz_class& d = key_pair.priv;
+
+    // the CRT recombination below expects p to be the larger prime
+    if (p < q)
+    {
+        std::swap(p, q);
+    }
+
+    key_pair.crt.p  = p;
+    key_pair.crt.q  = q;
+    key_pair.crt.dp = d % (p-1);
+    key_pair.crt.dq = d % (q-1);
+    Utilities::ModInverse(key_pair.crt.qinv, q, p);
+
+    return key_pair;
 }
 
+void Rsa::WriteKeyPair(const KeyPair& key_pair, const std::string& filename)
+{
+    // write a private copy next to the real file and move it into place, so
+    // that a crash never leaves a half written key behind
+    std::string tmp_filename = filename + ".tmp";
+    int fd = open(tmp_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    FILE* key_file = (fd < 0) ? NULL : fdopen(fd, "wb");
+    if (key_file == NULL)
+    {
+        throw std::runtime_error("Unable to write key file " + tmp_filename);
+    }
+
+    const mpz_class* numbers[] = { &key_pair.pub.N,  &key_pair.pub.e,  &key_pair.priv,
+                                   &key_pair.crt.p,  &key_pair.crt.q,
+                                   &key_pair.crt.dp, &key_pair.crt.dq, &key_pair.crt.qinv };
+    bool written = true;
+    for (const mpz_class* number : numbers)
+    {
+        written &= (mpz_out_raw(key_file, number->get_mpz_t()) != 0);
+    }
+
+    written &= (fflush(key_file) == 0) && (fsync(fd) == 0);
+    fclose(key_file);
+
+    if (!written || rename(tmp_filename.c_str(), filename.c_str()) != 0)
+    {
+        throw std::runtime_error("Unable to write key file " + filename);
+    }
+}
+
+bool Rsa::ReadKeyPair(KeyPair& key_pair, const std::string& filename)
+{
+    FILE* key_file = fopen(filename.c_str(), "rb");
+    if (key_file == NULL)
+    {
+        return false;
+    }
+
+    mpz_class* numbers[] = { &key_pair.pub.N,  &key_pair.pub.e,  &key_pair.priv,
+                             &key_pair.crt.p,  &key_pair.crt.q,
+                             &key_pair.crt.dp, &key_pair.crt.dq, &key_pair.crt.qinv };
+    bool read = true;
+    for (mpz_class* number : numbers)
+    {
+        read &= (mpz_inp_raw(number->get_mpz_t(), key_file) != 0);
+    }
+
+    fclose(key_file);
+
+    // make sure the pieces belong together before signing anything with them
+    const CrtKey& crt = key_pair.crt;
+    if (!read ||
+        key_pair.pub.N != crt.p*crt.q ||
+        (key_pair.priv*key_pair.pub.e) % ((crt.p-1)*(crt.q-1)) != 1)
+    {
+        throw std::runtime_error("Corrupt key file " + filename);
+    }
+
+    return true;
+}
@@ -24,9 +24,26 @@
 #include "Utilities.h"
 
 #include <cmath>
+#include <cstdlib>
+#include <gcrypt.h>
 #include <iostream>
+#include <mutex>
 #include <tuple>
 
+namespace
+{
+    std::once_flag gcrypt_initialized;
+
+    void InitializeGcrypt()
+    {
+        if (!gcry_check_version(GCRYPT_VERSION) )
+            exit(-1);
+
+        gcry_control(GCRYCTL_DISABLE_SECMEM, 0);
+        gcry_control(GCRYCTL_INITIALIZATION_FINISHED, 0);
+    }
+}
+
 mpz_class Utilities::StringToNumber(const std::string& str)
 {
     mpz_class z;
@@ -114,23 +131,27 @@ mpz_class Utilities::FastExp(const mpz_class& a,
 std::tuple<mpz_class, mpz_class, mpz_class> Utilities::ExtendedGcd(const mpz_class& a,
                                                                    const mpz_class& b)
 {
-    mpz_class x("1");
-    mpz_class y("0");
-    mpz_class g = a;
-    mpz_class r("0");
-    mpz_class s("1");
-    mpz_class t = b;
-    while (t > 0)
-    {
-        mpz_class q;
-        mpz_fdiv_q(q.get_mpz_t(), g.get_mpz_t(), t.get_mpz_t());
-
-        mpz_class u = x - q*r;
-        mpz_class v = y - q*s;
-        mpz_class w = g - q*t;
-        x = r; y = s; g = t;
-        r = u; s = v; t = w;
-    }
+    // GMP picks the smallest cofactors, |x| < b/(2g) and |y| < a/(2g)
+    mpz_class g;
+    mpz_class x;
+    mpz_class y;
+    mpz_gcdext(g.get_mpz_t(), x.get_mpz_t(), y.get_mpz_t(), a.get_mpz_t(), b.get_mpz_t());
+
+    return std::make_tuple(g, x, y);
+}
+
+bool Utilities::ModInverse(mpz_class& result, const mpz_class& a, const mpz_class& m)
+{
+    return mpz_invert(result.get_mpz_t(), a.get_mpz_t(), m.get_mpz_t()) != 0;
+}
+
+std::string Utilities::Sha256(const std::string& data)
+{
+    // libgcrypt only needs setting up once per process
+    std::call_once(gcrypt_initialized, InitializeGcrypt);
+
+    std::string digest(gcry_md_get_algo_dlen(GCRY_MD_SHA256), '\0');
+    gcry_md_hash_buffer( GCRY_MD_SHA256, &digest[0], data.data(), data.size() );
 
-    return std::make_tuple(g, x % b, y % a);
+    return digest;
 }
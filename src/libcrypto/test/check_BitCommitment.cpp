@@ -49,3 +49,28 @@ BOOST_AUTO_TEST_CASE(BitCommitment_test_2)
     BOOST_CHECK( Verify(newD,commitHash,commitR1));
 }
 
+BOOST_AUTO_TEST_CASE(BitCommitment_test_batch)
+{
+    std::vector<CommitData> revealed;
+    std::vector<CommitPair> originals;
+    for (unsigned int i = 0; i < 100; ++i)
+    {
+        CommitData d = GenCommitData(Utilities::StringToNumber("abcdefghijklmnopqrstuvwxyz"));
+        originals.push_back(CommitPair(Hash(d), d.r1));
+        revealed.push_back(d);
+    }
+
+    double start = omp_get_wtime();
+    BOOST_CHECK( VerifyBatch(revealed, originals) );
+    double end = omp_get_wtime();
+
+    std::cout << "Bit Commitment Batch Verify Timing " << end - start << "s" << std::endl;
+
+    // a single bad opening fails the batch
+    revealed[57].b = "zyxwvutsrqponmlkjihgfedcba";
+    BOOST_CHECK( !VerifyBatch(revealed, originals) );
+
+    // and so does a missing one
+    revealed.pop_back();
+    BOOST_CHECK( !VerifyBatch(revealed, originals) );
+}
@@ -27,6 +27,7 @@
 #include <gmpxx.h>
 #include <memory>
 #include <sstream>
+#include <vector>
 
 #include "BlindSignature.h"
 #include "Rsa.h"
@@ -88,3 +89,57 @@ BOOST_AUTO_TEST_CASE(blind_signature_test_1)
     BOOST_CHECK_EQUAL(message.str(), unblinded_str);
 }
 
+
+BOOST_AUTO_TEST_CASE(blind_signature_test_factors)
+{
+    Rsa::PrivateKey priv;
+    Rsa::PublicKey  pub;
+    std::tie(priv, pub) = Rsa::GenerateKeys(256);
+
+    double start = omp_get_wtime();
+    std::vector<BlindSignature::BlindingFactor> factors = BlindSignature::GenerateBlindingFactors(pub, 100);
+    double end = omp_get_wtime();
+    std::cout << "Blinding Factors (100) Timing " << end - start << "s" << std::endl;
+
+    BOOST_REQUIRE_EQUAL(factors.size(), 100U);
+    for (const auto& factor : factors)
+    {
+        // (k^-1)^e * k^e = 1 mod N
+        mpz_class product = Utilities::FastExp(factor.k_inv, pub.e, pub.N) * factor.k_e;
+        mpz_mod(product.get_mpz_t(), product.get_mpz_t(), pub.N.get_mpz_t());
+        BOOST_CHECK(product == 1);
+    }
+
+    mpz_class plain_text = Utilities::StringToNumber("this is a very secret message");
+
+    mpz_class unblinding_factor;
+    mpz_class blinded_text;
+    std::tie(blinded_text, unblinding_factor) = BlindSignature::Blind(plain_text, pub, factors[42], true);
+    BOOST_CHECK(unblinding_factor == factors[42].k_inv);
+
+    mpz_class signed_blinded_text = Rsa::Sign(blinded_text, priv, pub, false);
+    mpz_class unblinded_signed_text = BlindSignature::Unblind(signed_blinded_text, pub, unblinding_factor, false);
+    BOOST_CHECK(Rsa::Unsign(unblinded_signed_text, pub, true) == plain_text);
+
+    BOOST_CHECK(BlindSignature::GenerateBlindingFactors(pub, 0).empty());
+}
+
+BOOST_AUTO_TEST_CASE(BlindSignature_test_full_domain_hash)
+{
+    Rsa::KeyPair key_pair = Rsa::GenerateKeyPair(256);
+    const Rsa::PublicKey& pub = key_pair.pub;
+
+    const std::string message = "a money order";
+    mpz_class hash = Rsa::FullDomainHash(message, pub);
+
+    mpz_class unblinding_factor;
+    mpz_class blinded_hash;
+    std::tie(blinded_hash, unblinding_factor) = BlindSignature::Blind(hash, pub, false);
+
+    // the signer can check an opened blinding against the message
+    BOOST_CHECK(BlindSignature::VerifyBlinding(blinded_hash, hash, pub, unblinding_factor));
+    BOOST_CHECK(!BlindSignature::VerifyBlinding(blinded_hash, Rsa::FullDomainHash("another order", pub), pub, unblinding_factor));
+
+    mpz_class signature = BlindSignature::Unblind(Rsa::Sign(blinded_hash, key_pair, false), pub, unblinding_factor, false);
+    BOOST_CHECK(Rsa::VerifyFullDomainHash(message, signature, pub));
+}
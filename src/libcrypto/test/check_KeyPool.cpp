@@ -0,0 +1,51 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <thread>
+#include <gmpxx.h>
+
+#include "KeyPool.h"
+#include "Utilities.h"
+
+BOOST_AUTO_TEST_CASE(key_pool_test_1)
+{
+    Rsa::KeyPool pool(128, 2);
+
+    Rsa::KeyPair first  = pool.Take();
+    Rsa::KeyPair second = pool.Take();
+    BOOST_CHECK(first.pub.N != second.pub.N);
+
+    mpz_class plain_text = Utilities::StringToNumber("this is a very secret message");
+    BOOST_CHECK(Rsa::Unsign(Rsa::Sign(plain_text, second, true), second.pub, true) == plain_text);
+
+    // the pool fills itself back up
+    for (int i = 0; i < 500 && pool.Available() < 2; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    BOOST_CHECK_EQUAL(pool.Available(), 2u);
+}
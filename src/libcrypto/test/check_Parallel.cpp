@@ -0,0 +1,98 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "Parallel.h"
+ 
+BOOST_AUTO_TEST_CASE(parallel_test_1)
+{
+    std::vector<int> out(1000, 0);
+
+    Parallel::For(out.size(), [&](size_t i) { out[i] = i*2; });
+
+    for (size_t i = 0; i < out.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(out[i], static_cast<int>(i*2));
+    }
+
+    // nothing to do
+    Parallel::For(0, [&](size_t i) { out[i] = -1; });
+    BOOST_CHECK_EQUAL(out[0], 0);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_test_2)
+{
+    std::vector<int> out(100, 0);
+
+    BOOST_CHECK_THROW(Parallel::For(out.size(), [&](size_t i)
+                                    {
+                                        if (i == 42)
+                                        {
+                                            throw std::runtime_error("bad index");
+                                        }
+                                        out[i] = 1;
+                                    }),
+                      std::runtime_error);
+
+    // everything else still ran
+    BOOST_CHECK_EQUAL(out[41], 1);
+    BOOST_CHECK_EQUAL(out[43], 1);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_test_3)
+{
+    const std::thread::id caller = std::this_thread::get_id();
+
+    // too few calls to be worth a thread
+    std::vector<std::thread::id> ids(3);
+    Parallel::For(ids.size(), [&](size_t i) { ids[i] = std::this_thread::get_id(); }, 4);
+    for (const auto& id : ids)
+    {
+        BOOST_CHECK(id == caller);
+    }
+
+    // a For inside another stays on the thread that runs the outer call
+    std::vector<int> mismatches(Parallel::NumThreads() * 2, 0);
+    Parallel::For(mismatches.size(), [&](size_t i)
+    {
+        const std::thread::id outer = std::this_thread::get_id();
+        Parallel::For(100, [&](size_t)
+        {
+            if (std::this_thread::get_id() != outer)
+            {
+                ++mismatches[i];
+            }
+        });
+    });
+
+    for (const auto n : mismatches)
+    {
+        BOOST_CHECK_EQUAL(n, 0);
+    }
+}
@@ -61,3 +61,20 @@ BOOST_AUTO_TEST_CASE(prime_test_1)
 
     BOOST_CHECK_EQUAL(probably_prime, 1);
 }
+
+BOOST_AUTO_TEST_CASE(prime_test_sizes)
+{
+    // small sizes skip the sieve, the rest go through it
+    const int sizes[] = { 8, 31, 32, 64, 256, 2048 };
+
+    for (int num_bits : sizes)
+    {
+        double start = omp_get_wtime();
+        mpz_class prime = PrimeGenerator::GetPrimeNumber(num_bits);
+        double end = omp_get_wtime();
+        std::cout << "Prime Generator (" << num_bits << " bit) Test Timing " << end - start << "s" << std::endl;
+
+        BOOST_CHECK_EQUAL(mpz_probab_prime_p(prime.get_mpz_t(), 25) > 0, true);
+        BOOST_CHECK(mpz_sizeinbase(prime.get_mpz_t(), 2) >= static_cast<size_t>(num_bits));
+    }
+}
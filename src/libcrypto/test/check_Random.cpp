@@ -27,6 +27,11 @@
 #include <gmpxx.h>
 
 #include "Random.h"
+
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
  
 BOOST_AUTO_TEST_CASE(random_test_1)
 {
@@ -43,3 +48,58 @@ BOOST_AUTO_TEST_CASE(random_test_1)
     BOOST_CHECK_EQUAL(mpz_sizeinbase(random_2.get_mpz_t(), 2), num_bits);
 
 }
+
+BOOST_AUTO_TEST_CASE(random_test_short)
+{
+    // a short number still comes from a full seed, so draws differ
+    std::set<unsigned long> draws;
+    for (int i = 0; i < 20; ++i)
+    {
+        draws.insert(Random::GenerateRandomNumberBits(8).get_ui());
+    }
+
+    BOOST_CHECK(draws.size() > 1);
+}
+
+BOOST_AUTO_TEST_CASE(random_test_numbers_range)
+{
+    const mpz_class num = 10;
+    std::vector<mpz_class> numbers = Random::GenerateRandomNumbersRange(num, 100);
+
+    BOOST_REQUIRE_EQUAL(numbers.size(), 100U);
+    std::set<unsigned long> seen;
+    for (const auto& number : numbers)
+    {
+        BOOST_CHECK(number >= 1 && number <= num);
+        seen.insert(number.get_ui());
+    }
+    BOOST_CHECK(seen.size() > 1);
+}
+
+BOOST_AUTO_TEST_CASE(random_test_bytes)
+{
+    std::string bytes_1 = Random::GenerateRandomBytes(16);
+    std::string bytes_2 = Random::GenerateRandomBytes(16);
+
+    BOOST_CHECK_EQUAL(bytes_1.size(), 16U);
+    BOOST_CHECK(bytes_1 != bytes_2);
+    BOOST_CHECK(Random::GenerateRandomBytes(0).empty());
+}
+
+BOOST_AUTO_TEST_CASE(random_test_sample)
+{
+    std::vector<unsigned int> sample = Random::Sample(100, 10);
+    BOOST_REQUIRE_EQUAL(sample.size(), 10U);
+
+    std::set<unsigned int> distinct(sample.begin(), sample.end());
+    BOOST_CHECK_EQUAL(distinct.size(), 10U);
+    BOOST_CHECK(*distinct.rbegin() < 100);
+
+    // drawing everything is a permutation
+    sample = Random::Sample(50, 50);
+    distinct = std::set<unsigned int>(sample.begin(), sample.end());
+    BOOST_CHECK_EQUAL(distinct.size(), 50U);
+
+    BOOST_CHECK(Random::Sample(5, 0).empty());
+    BOOST_CHECK_THROW(Random::Sample(5, 6), std::invalid_argument);
+}
@@ -29,7 +29,9 @@
 #include "Rsa.h"
 #include "Utilities.h"
 
+#include <cstdio>
 #include <sstream>
+#include <stdexcept>
 #include <omp.h>
 
 namespace
@@ -203,3 +205,189 @@ BOOST_AUTO_TEST_CASE(Rsa_test_3)
     BOOST_CHECK(plain_text == unsigned_plain_text);
 }
 
+BOOST_AUTO_TEST_CASE(Rsa_test_batch_unsign)
+{
+    Rsa::PrivateKey priv;
+    Rsa::PublicKey  pub;
+    std::tie(priv, pub) = Rsa::GenerateKeys(256);
+
+    std::vector<mpz_class> plain_texts;
+    std::vector<mpz_class> signed_texts;
+    for (unsigned int i = 0; i < 16; ++i)
+    {
+        std::stringstream message;
+        message << "this is very secret message number " << i;
+        plain_texts.push_back(Utilities::StringToNumber(message.str()));
+        signed_texts.push_back(Rsa::Sign(plain_texts.back(), priv, pub, true));
+    }
+
+    std::vector<mpz_class> unsigned_texts = Rsa::Unsign(signed_texts, pub, true);
+
+    BOOST_REQUIRE_EQUAL(unsigned_texts.size(), plain_texts.size());
+    for (size_t i = 0; i < plain_texts.size(); ++i)
+    {
+        BOOST_CHECK(plain_texts[i] == unsigned_texts[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Rsa_test_crt_sign)
+{
+    Rsa::KeyPair key_pair = Rsa::GenerateKeyPair(256);
+
+    mpz_class plain_text = Utilities::StringToNumber("this is a very secret message");
+
+    // the CRT path has to produce exactly what signing with d produces
+    mpz_class crt_signed   = Rsa::Sign(plain_text, key_pair, true);
+    mpz_class plain_signed = Rsa::Sign(plain_text, key_pair.priv, key_pair.pub, true);
+    BOOST_CHECK(crt_signed == plain_signed);
+
+    BOOST_CHECK(Rsa::Unsign(crt_signed, key_pair.pub, true) == plain_text);
+}
+
+BOOST_AUTO_TEST_CASE(Rsa_test_key_file)
+{
+    const std::string filename = "Rsa_test_key_file.key";
+    std::remove(filename.c_str());
+
+    Rsa::KeyPair loaded;
+    BOOST_CHECK(!Rsa::ReadKeyPair(loaded, filename));
+
+    Rsa::KeyPair key_pair = Rsa::GenerateKeyPair(256);
+    Rsa::WriteKeyPair(key_pair, filename);
+
+    BOOST_REQUIRE(Rsa::ReadKeyPair(loaded, filename));
+    BOOST_CHECK(loaded.pub.N    == key_pair.pub.N);
+    BOOST_CHECK(loaded.pub.e    == key_pair.pub.e);
+    BOOST_CHECK(loaded.priv     == key_pair.priv);
+    BOOST_CHECK(loaded.crt.qinv == key_pair.crt.qinv);
+
+    // a damaged file is refused rather than used for signing
+    FILE* key_file = fopen(filename.c_str(), "r+b");
+    fseek(key_file, 8, SEEK_SET);
+    int byte = fgetc(key_file);
+    fseek(key_file, 8, SEEK_SET);
+    fputc(byte ^ 0xff, key_file);
+    fclose(key_file);
+    BOOST_CHECK_THROW(Rsa::ReadKeyPair(loaded, filename), std::runtime_error);
+
+    std::remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(Rsa_test_full_domain_hash)
+{
+    Rsa::KeyPair key_pair = Rsa::GenerateKeyPair(256);
+    const Rsa::PublicKey& pub = key_pair.pub;
+
+    const std::string message(5000, 'x');
+
+    mpz_class hash = Rsa::FullDomainHash(message, pub);
+    BOOST_CHECK(hash >= 0 && hash < pub.N);
+    BOOST_CHECK(hash == Rsa::FullDomainHash(message, pub));
+    BOOST_CHECK(hash != Rsa::FullDomainHash(message + "y", pub));
+
+    // however long the message, the signature is a single block
+    mpz_class signature = Rsa::Sign(hash, key_pair, false);
+    BOOST_CHECK(signature < pub.N);
+    BOOST_CHECK(Rsa::VerifyFullDomainHash(message, signature, pub));
+    BOOST_CHECK(!Rsa::VerifyFullDomainHash(message + "y", signature, pub));
+    BOOST_CHECK(!Rsa::VerifyFullDomainHash(message, signature + pub.N, pub));
+
+    std::vector<std::string> messages = { message, "something else", message };
+    std::vector<mpz_class>   signatures = { signature, signature, signature };
+    std::vector<bool>        valid = Rsa::VerifyFullDomainHash(messages, signatures, pub);
+    BOOST_REQUIRE_EQUAL(valid.size(), 3U);
+    BOOST_CHECK(valid[0] && !valid[1] && valid[2]);
+}
+
+BOOST_AUTO_TEST_CASE(Rsa_test_many_blocks)
+{
+    Rsa::KeyPair key_pair = Rsa::GenerateKeyPair(256);
+
+    // long enough to be split into blocks and exponentiated on several threads
+    std::string message;
+    for (unsigned int i = 0; i < 200; ++i)
+    {
+        message += "block " + std::to_string(i) + " ";
+    }
+    mpz_class plain_text = Utilities::StringToNumber(message);
+
+    mpz_class cipher_text = Rsa::Encipher(plain_text, key_pair.pub, true);
+    BOOST_CHECK(Rsa::Decipher(cipher_text, key_pair.priv, key_pair.pub, true) == plain_text);
+
+    mpz_class signed_text = Rsa::Sign(plain_text, key_pair, true);
+    BOOST_CHECK(signed_text == Rsa::Sign(plain_text, key_pair.priv, key_pair.pub, true));
+    BOOST_CHECK(Rsa::Unsign(signed_text, key_pair.pub, true) == plain_text);
+    BOOST_CHECK(Utilities::NumberToString(Rsa::Unsign(signed_text, key_pair.pub, true)) == message);
+}
+
+BOOST_AUTO_TEST_CASE(Rsa_test_block_stream)
+{
+    Rsa::KeyPair key_pair = Rsa::GenerateKeyPair(256);
+
+    mpz_class plain_text = Utilities::StringToNumber(std::string(1000, 'z'));
+    const std::string cipher_digits = Rsa::BlockDigits(Rsa::Encipher(plain_text, key_pair.pub, true), key_pair.pub);
+    const std::string signed_digits = Rsa::BlockDigits(Rsa::Sign(plain_text, key_pair, true), key_pair.pub);
+    BOOST_CHECK_EQUAL(cipher_digits.size() % mpz_sizeinbase(key_pair.pub.N.get_mpz_t(), BASE), 0U);
+
+    // pieces that do not line up with the blocks
+    Rsa::BlockStream decipher(key_pair.priv, key_pair.pub, true);
+    for (size_t i = 0; i < cipher_digits.size(); i += 37)
+    {
+        decipher.Feed(cipher_digits.substr(i, 37));
+    }
+    BOOST_CHECK(decipher.Finish() == plain_text);
+
+    Rsa::BlockStream unsign(key_pair.pub, true);
+    unsign.Feed(signed_digits);
+    BOOST_CHECK(unsign.Finish() == plain_text);
+
+    // a block cut short
+    Rsa::BlockStream partial(key_pair.pub, true);
+    partial.Feed(signed_digits.data(), signed_digits.size() - 1);
+    BOOST_CHECK_THROW(partial.Finish(), std::invalid_argument);
+
+    Rsa::BlockStream empty(key_pair.pub, true);
+    BOOST_CHECK_THROW(empty.Finish(), std::invalid_argument);
+}
+
+
+BOOST_AUTO_TEST_CASE(Rsa_test_batch_screening)
+{
+    Rsa::KeyPair key_pair = Rsa::GenerateKeyPair(256);
+    const Rsa::PublicKey& pub = key_pair.pub;
+
+    std::vector<std::string> messages;
+    std::vector<mpz_class>   signatures;
+    for (unsigned int i = 0; i < 20; ++i)
+    {
+        messages.push_back("money order " + std::to_string(i));
+        signatures.push_back(Rsa::Sign(Rsa::FullDomainHash(messages.back(), pub), key_pair, false));
+    }
+
+    BOOST_CHECK(Rsa::ScreenFullDomainHash(messages, signatures, pub));
+    BOOST_CHECK(Rsa::ScreenFullDomainHash(messages, signatures, pub, 64));
+    BOOST_CHECK(Rsa::ScreenFullDomainHash(std::vector<std::string>(), std::vector<mpz_class>(), pub));
+
+    // one forged coin fails the screen, and the fallback finds it
+    std::vector<mpz_class> forged = signatures;
+    forged[7] = forged[7] + 1;
+    BOOST_CHECK(!Rsa::ScreenFullDomainHash(messages, forged, pub));
+
+    std::vector<bool> valid = Rsa::BatchVerifyFullDomainHash(messages, forged, pub);
+    BOOST_REQUIRE_EQUAL(valid.size(), messages.size());
+    for (size_t i = 0; i < valid.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(valid[i], i != 7);
+    }
+
+    // moving a factor from one signature to another keeps the product, only the
+    // random exponents notice
+    mpz_class x = 12345;
+    mpz_class x_inv;
+    BOOST_REQUIRE(Utilities::ModInverse(x_inv, x, pub.N));
+    std::vector<mpz_class> shuffled = signatures;
+    shuffled[2] = (shuffled[2] * x) % pub.N;
+    shuffled[3] = (shuffled[3] * x_inv) % pub.N;
+    BOOST_CHECK(Rsa::ScreenFullDomainHash(messages, shuffled, pub));
+    BOOST_CHECK(!Rsa::ScreenFullDomainHash(messages, shuffled, pub, 64));
+}
@@ -27,7 +27,39 @@
 #include <gmpxx.h>
 #include <iostream>
 
+#include "Random.h"
 #include "Utilities.h"
+
+#include <omp.h>
+
+namespace
+{
+    // the plain Euclid loop ExtendedGcd used before it moved to mpz_gcdext,
+    // kept as a reference for the results and the timings below
+    std::tuple<mpz_class, mpz_class, mpz_class> EuclidExtendedGcd(const mpz_class& a,
+                                                                   const mpz_class& b)
+    {
+        mpz_class x("1");
+        mpz_class y("0");
+        mpz_class g = a;
+        mpz_class r("0");
+        mpz_class s("1");
+        mpz_class t = b;
+        while (t > 0)
+        {
+            mpz_class q;
+            mpz_fdiv_q(q.get_mpz_t(), g.get_mpz_t(), t.get_mpz_t());
+
+            mpz_class u = x - q*r;
+            mpz_class v = y - q*s;
+            mpz_class w = g - q*t;
+            x = r; y = s; g = t;
+            r = u; s = v; t = w;
+        }
+
+        return std::make_tuple(g, x % b, y % a);
+    }
+}
  
 BOOST_AUTO_TEST_CASE(utilties_test_1)
 {
@@ -71,3 +103,66 @@ BOOST_AUTO_TEST_CASE(utilties_test_4)
     BOOST_CHECK(x == -16);
     BOOST_CHECK(y == 27);
 }
+
+BOOST_AUTO_TEST_CASE(utilties_test_mod_inverse)
+{
+    mpz_class inverse;
+    BOOST_CHECK(Utilities::ModInverse(inverse, 3, 11));
+    BOOST_CHECK(inverse == 4);
+
+    // 6 and 9 share a factor
+    BOOST_CHECK(!Utilities::ModInverse(inverse, 6, 9));
+}
+
+BOOST_AUTO_TEST_CASE(utilties_test_sha256)
+{
+    // FIPS 180-2 test vector
+    mpz_class digest;
+    std::string bytes = Utilities::Sha256("abc");
+    BOOST_REQUIRE_EQUAL(bytes.size(), 32U);
+    mpz_import(digest.get_mpz_t(), bytes.size(), 1, 1, 1, 0, bytes.data());
+    BOOST_CHECK(digest == mpz_class("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", 16));
+}
+
+BOOST_AUTO_TEST_CASE(utilties_test_gcd_timing)
+{
+    const unsigned int iterations = 1000;
+
+    for (unsigned int num_bits : { 256, 1024, 2048 })
+    {
+        mpz_class a = Random::GenerateRandomNumberBits(num_bits);
+        mpz_class b = Random::GenerateRandomNumberBits(num_bits - 1);
+
+        mpz_class gcd;
+        mpz_class x;
+        mpz_class y;
+        std::tie(gcd, x, y) = Utilities::ExtendedGcd(a, b);
+        BOOST_CHECK(a*x + b*y == gcd);
+        BOOST_CHECK(std::make_tuple(gcd, x, y) == EuclidExtendedGcd(a, b));
+
+        double start = omp_get_wtime();
+        for (unsigned int i = 0; i < iterations; ++i)
+        {
+            EuclidExtendedGcd(a, b);
+        }
+        double euclid = (omp_get_wtime() - start) / iterations;
+
+        start = omp_get_wtime();
+        for (unsigned int i = 0; i < iterations; ++i)
+        {
+            Utilities::ExtendedGcd(a, b);
+        }
+        double gmp = (omp_get_wtime() - start) / iterations;
+
+        mpz_class inverse;
+        start = omp_get_wtime();
+        for (unsigned int i = 0; i < iterations; ++i)
+        {
+            Utilities::ModInverse(inverse, b, a);
+        }
+        double invert = (omp_get_wtime() - start) / iterations;
+
+        std::cout << "ExtendedGcd (" << num_bits << " bit) Euclid " << euclid << "s"
+                  << " gcdext " << gmp << "s ModInverse " << invert << "s" << std::endl;
+    }
+}
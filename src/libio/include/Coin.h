@@ -0,0 +1,66 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#ifndef COIN_H_
+#define COIN_H_
+
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include "Serializable.h"
+
+#include <string>
+
+// A spendable money order: the serialized MoneyOrder and the bank's signature on
+// its full domain hash.  The epoch and denomination name the bank key that signed it.
+class Coin : public Serializable<Coin>
+{
+    public:
+        Coin() : Serializable(this) {}
+        ~Coin() = default;
+
+        // copy constructor
+        Coin(const Coin& other) : Serializable(this)
+        {
+            m_money_order = other.m_money_order;
+            m_signature   = other.m_signature;
+            m_amount      = other.m_amount;
+            m_epoch       = other.m_epoch;
+        }
+
+        std::string  m_money_order;
+        std::string  m_signature;   // base 10
+        unsigned int m_amount = 0;
+        unsigned int m_epoch  = 0;
+
+    private:
+        friend class boost::serialization::access;
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version)
+        {
+            ar & m_money_order;
+            ar & m_signature;
+            ar & m_amount;
+            ar & m_epoch;
+        }
+};
+#endif // COIN_H_
@@ -0,0 +1,116 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#ifndef COINID_H_
+#define COINID_H_
+
+#include <boost/serialization/access.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+// What tells one money order from every other: 128 random bits picked by the buyer.
+// The bank keeps the id of every coin ever deposited, so it is fixed width and binary,
+// comparing two ids is two integer compares.
+class CoinId
+{
+    public:
+        static const size_t LENGTH = 16;
+
+        CoinId() : m_high(0), m_low(0) {}
+
+        // from LENGTH big endian bytes, throws std::invalid_argument for any other length
+        explicit CoinId(const std::string& bytes) : m_high(0), m_low(0)
+        {
+            if (bytes.size() != LENGTH)
+            {
+                throw std::invalid_argument("A coin id is 16 bytes");
+            }
+
+            for (size_t i = 0; i < LENGTH / 2; ++i)
+            {
+                m_high = (m_high << 8) | static_cast<unsigned char>(bytes[i]);
+                m_low  = (m_low  << 8) | static_cast<unsigned char>(bytes[i + LENGTH / 2]);
+            }
+        }
+
+        std::string Bytes() const
+        {
+            std::string bytes(LENGTH, '\0');
+            for (size_t i = 0; i < LENGTH / 2; ++i)
+            {
+                bytes[LENGTH / 2 - 1 - i] = static_cast<char>((m_high >> (8*i)) & 0xFF);
+                bytes[LENGTH - 1 - i]     = static_cast<char>((m_low  >> (8*i)) & 0xFF);
+            }
+
+            return bytes;
+        }
+
+        // for logs
+        std::string Hex() const
+        {
+            static const char digits[] = "0123456789abcdef";
+
+            std::string hex;
+            for (const unsigned char c : Bytes())
+            {
+                hex += digits[c >> 4];
+                hex += digits[c & 0xF];
+            }
+
+            return hex;
+        }
+
+        bool operator==(const CoinId& other) const { return m_high == other.m_high && m_low == other.m_low; }
+        bool operator!=(const CoinId& other) const { return !(*this == other); }
+        bool operator<(const CoinId& other) const
+        {
+            return m_high < other.m_high || (m_high == other.m_high && m_low < other.m_low);
+        }
+
+        // every id costs its buyer a withdrawal, so nobody can cheaply make ids that
+        // share a bucket; mixing the halves is enough
+        struct Hash
+        {
+            size_t operator()(const CoinId& id) const
+            {
+                uint64_t h = (id.m_high ^ (id.m_low * 0x9E3779B97F4A7C15ULL));
+                return static_cast<size_t>(h ^ (h >> 32));
+            }
+        };
+
+    private:
+        friend class boost::serialization::access;
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version)
+        {
+            ar & m_high;
+            ar & m_low;
+        }
+
+        uint64_t m_high;
+        uint64_t m_low;
+};
+#endif // COINID_H_
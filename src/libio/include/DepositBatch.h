@@ -0,0 +1,124 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#ifndef DEPOSITBATCH_H_
+#define DEPOSITBATCH_H_
+
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include "Coin.h"
+#include "Serializable.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Everything the bank needs to deposit one money order: the coin, the selector string
+// the merchant sent the buyer and the buyer's revealed halves.  The depositor numbers
+// each deposit once, and sending it again keeps the number, so the bank can tell a
+// deposit sent twice from a money order deposited twice.
+class Deposit : public Serializable<Deposit>
+{
+    public:
+        Deposit() : Serializable(this) {}
+        ~Deposit() = default;
+
+        // copy constructor
+        Deposit(const Deposit& other) : Serializable(this)
+        {
+            m_coin        = other.m_coin;
+            m_selector    = other.m_selector;
+            m_commit_data = other.m_commit_data;
+            m_sequence    = other.m_sequence;
+        }
+
+        Coin                     m_coin;
+        std::string              m_selector;
+        std::vector<std::string> m_commit_data;
+        // the depositor's number for the deposit, never used twice, or 0 if the deposit
+        // is not numbered
+        uint64_t                 m_sequence = 0;
+
+    private:
+        friend class boost::serialization::access;
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version)
+        {
+            ar & m_coin;
+            ar & m_selector;
+            ar & m_commit_data;
+            ar & m_sequence;
+        }
+};
+
+// Several deposits from one depositor, sent with a single DEPOSIT BATCH command
+class DepositBatch : public Serializable<DepositBatch>
+{
+    public:
+        DepositBatch() : Serializable(this) {}
+        ~DepositBatch() = default;
+
+        // copy constructor
+        DepositBatch(const DepositBatch& other) : Serializable(this)
+        {
+            m_depositor = other.m_depositor;
+            m_deposits  = other.m_deposits;
+        }
+
+        std::string          m_depositor;
+        std::vector<Deposit> m_deposits;
+
+    private:
+        friend class boost::serialization::access;
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version)
+        {
+            ar & m_depositor;
+            ar & m_deposits;
+        }
+};
+
+// The bank's answer to a DepositBatch, one result per deposit and in the same order
+class DepositReceipt : public Serializable<DepositReceipt>
+{
+    public:
+        DepositReceipt() : Serializable(this) {}
+        ~DepositReceipt() = default;
+
+        // copy constructor
+        DepositReceipt(const DepositReceipt& other) : Serializable(this)
+        {
+            m_results = other.m_results;
+        }
+
+        std::vector<std::string> m_results;
+
+    private:
+        friend class boost::serialization::access;
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version)
+        {
+            ar & m_results;
+        }
+};
+#endif // DEPOSITBATCH_H_
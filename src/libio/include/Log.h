@@ -0,0 +1,100 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#ifndef LOG_H_
+#define LOG_H_
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//! Asynchronous, structured logging for the servers.  A record is a level, a message
+//! and key=value fields:
+//!
+//!     Log::Info("account opened").Field("identity", identity).Field("amount", amount);
+//!
+//! The record is formatted into one line and put on a lock-free ring when the statement
+//! ends; a background thread writes the ring out and flushes once per batch, so the
+//! caller never waits on stdout.  When the ring is full the record is dropped and
+//! counted in the log_dropped_total metric rather than blocking the caller.
+//!
+//! Lines look like
+//!     2015-04-01T12:00:00.123Z INFO account opened identity=alice amount=100
+//! with values quoted when they contain spaces or other special characters.
+/////////////////////////////////////////////////////////////////////////////////////////
+namespace Log
+{
+    enum class Level
+    {
+        DEBUG,
+        INFO,
+        WARNING,
+        ERROR
+    };
+
+    // records below this level are ignored, INFO by default
+    void SetLevel( const Level level );
+    bool Enabled( const Level level );
+
+    // where the writer thread sends records, stdout and stderr by default
+    void SetStreams( FILE* info, FILE* warnings );
+
+    // waits until every record logged so far has been written
+    void Flush();
+
+    class Record
+    {
+        public:
+            Record( const Level level, const char* message );
+            Record( Record&& other );
+            ~Record();
+
+            Record& Field( const char* key, const std::string& value );
+            Record& Field( const char* key, const char* value );
+
+            template<typename T>
+            typename std::enable_if<std::is_arithmetic<T>::value, Record&>::type
+            Field( const char* key, const T value )
+            {
+                return enabled ? Field( key, std::to_string(value) ) : *this;
+            }
+
+        private:
+            Record( const Record& ) = delete;
+            Record& operator=( const Record& ) = delete;
+
+            bool                                  enabled;
+            Level                                 level;
+            std::chrono::system_clock::time_point time;
+            std::string                           text;
+    };
+
+    inline Record Debug( const char* message )   { return Record( Level::DEBUG, message ); }
+    inline Record Info( const char* message )    { return Record( Level::INFO, message ); }
+    inline Record Warning( const char* message ) { return Record( Level::WARNING, message ); }
+    inline Record Error( const char* message )   { return Record( Level::ERROR, message ); }
+}
+
+#endif // LOG_H_
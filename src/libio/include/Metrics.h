@@ -0,0 +1,165 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//! Counters, gauges and latency histograms that are cheap enough for the request path.
+//! Counters and histograms are split into shards and each thread updates its own, so
+//! threads serving different connections do not fight over a cache line.  Metrics live
+//! in a process wide registry for the life of the process; look one up once and keep
+//! the reference:
+//!
+//!     static Metrics::Counter& deposits = Metrics::GetCounter("bank_deposits_total", "...");
+//!     deposits.Increment();
+//!
+//! A name may carry Prometheus labels, e.g. bank_command_seconds{command="open_account"},
+//! every metric with the same name before the labels shares the help text.
+/////////////////////////////////////////////////////////////////////////////////////////
+namespace Metrics
+{
+    const unsigned int NUM_SHARDS = 8;
+
+    class Counter
+    {
+        public:
+            Counter();
+
+            void     Increment( const uint64_t n = 1 );
+            uint64_t Value() const;
+
+        private:
+            Counter( const Counter& ) = delete;
+            Counter& operator=( const Counter& ) = delete;
+
+            // one cache line per shard
+            struct Shard
+            {
+                std::atomic<uint64_t> value;
+                char                  padding[64 - sizeof(std::atomic<uint64_t>)];
+            };
+
+            Shard m_shards[NUM_SHARDS];
+    };
+
+    // a value that goes up and down, like the number of open connections
+    class Gauge
+    {
+        public:
+            Gauge() : m_value(0) {}
+
+            void    Add( const int64_t n ) { m_value.fetch_add(n, std::memory_order_relaxed); }
+            int64_t Value() const          { return m_value.load(std::memory_order_relaxed); }
+
+        private:
+            Gauge( const Gauge& ) = delete;
+            Gauge& operator=( const Gauge& ) = delete;
+
+            std::atomic<int64_t> m_value;
+    };
+
+    // what a histogram held at one point in time
+    struct HistogramSnapshot
+    {
+        std::vector<uint64_t> buckets;
+        uint64_t              count = 0;
+        uint64_t              sum   = 0;
+
+        // the largest value, in nanoseconds, that falls in the same bucket as the
+        // p-th quantile, 0 for an empty histogram
+        uint64_t Percentile( const double p ) const;
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    //! Log-linear buckets of nanoseconds in the manner of an HDR histogram: every power
+    //! of two is split into SUB_BUCKETS buckets, so a recorded value is off by at most
+    //! 1/SUB_BUCKETS of itself.  Values above MAX_VALUE land in the last bucket.
+    /////////////////////////////////////////////////////////////////////////////////////
+    class Histogram
+    {
+        public:
+            static const unsigned int SUB_BUCKET_BITS = 4;
+            static const unsigned int SUB_BUCKETS     = 1u << SUB_BUCKET_BITS;
+            static const unsigned int MAX_EXPONENT    = 40;
+            static const uint64_t     MAX_VALUE       = (1ULL << MAX_EXPONENT) - 1;
+            static const unsigned int NUM_BUCKETS     = SUB_BUCKETS * (MAX_EXPONENT - SUB_BUCKET_BITS + 1);
+
+            Histogram();
+
+            void Record( const uint64_t nanoseconds );
+            void Record( const std::chrono::steady_clock::duration elapsed );
+
+            HistogramSnapshot Snapshot() const;
+
+            static unsigned int BucketIndex( const uint64_t value );
+            // the smallest and largest values that fall in a bucket
+            static uint64_t     BucketLowerBound( const unsigned int index );
+            static uint64_t     BucketUpperBound( const unsigned int index );
+
+        private:
+            Histogram( const Histogram& ) = delete;
+            Histogram& operator=( const Histogram& ) = delete;
+
+            struct Shard
+            {
+                std::atomic<uint64_t> buckets[NUM_BUCKETS];
+                std::atomic<uint64_t> sum;
+            };
+
+            Shard m_shards[NUM_SHARDS];
+    };
+
+    // times a scope and records it in a histogram when it ends
+    class ScopedTimer
+    {
+        public:
+            explicit ScopedTimer( Histogram& histogram )
+                : histogram( histogram ),
+                  start( std::chrono::steady_clock::now() ) {}
+
+            ~ScopedTimer() { histogram.Record( std::chrono::steady_clock::now() - start ); }
+
+        private:
+            Histogram&                            histogram;
+            std::chrono::steady_clock::time_point start;
+    };
+
+    // the metric with this name, created the first time it is asked for.  Throws
+    // std::logic_error if the name is already taken by a metric of another kind.
+    Counter&   GetCounter( const std::string& name, const std::string& help );
+    Gauge&     GetGauge( const std::string& name, const std::string& help );
+    Histogram& GetHistogram( const std::string& name, const std::string& help );
+
+    // every metric in the Prometheus text format, names prefixed with koolkash_ and
+    // histograms in seconds
+    std::string Exposition();
+}
+
+#endif // METRICS_H_
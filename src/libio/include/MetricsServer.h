@@ -0,0 +1,46 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#ifndef METRICSSERVER_H_
+#define METRICSSERVER_H_
+
+#include "NetComm.h"
+
+namespace Metrics
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+    //! Answers every connection with Metrics::Exposition() as a plain HTTP response, so
+    //! that curl or a Prometheus scraper can read it.  Listens on the loopback address.
+    /////////////////////////////////////////////////////////////////////////////////////
+    class MetricsServer : public NetComm::Server
+    {
+        public:
+            MetricsServer( unsigned short port );
+            void run(tcp::socket sock1);
+    };
+
+    // serves the metrics from a background thread for the rest of the process
+    void StartMetricsServer( unsigned short port );
+}
+
+#endif // METRICSSERVER_H_
@@ -27,11 +27,14 @@
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/archive/binary_iarchive.hpp>
 #include "BitCommitment.h"
+#include "CoinId.h"
 #include "Serializable.h"
 
 #include <vector>
 
 
+// The value of a money order is not part of it, it is implied by the
+// denomination key the bank signed it with
 class MoneyOrder : public Serializable<MoneyOrder>
 {
     public:
@@ -43,21 +46,18 @@ class MoneyOrder : public Serializable<MoneyOrder>
         {
             m_identity_strings = other.m_identity_strings;
             m_uniqueness       = other.m_uniqueness;
-            m_amount           = other.m_amount;
         }
 
         typedef std::pair<CommitPair, CommitPair> IdentityPair;
 
         std::vector<IdentityPair> m_identity_strings;
-        std::string m_uniqueness;
-        unsigned int m_amount = 0;
+        CoinId m_uniqueness;
 
     private:
         friend class boost::serialization::access;
         template<class Archive>
         void serialize(Archive & ar, const unsigned int version)
         {
-            ar & m_amount;
             ar & m_uniqueness;
             ar & m_identity_strings;
         }
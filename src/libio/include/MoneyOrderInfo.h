@@ -40,10 +40,14 @@ class MoneyOrderInfo : public Serializable<MoneyOrderInfo>
         // copy constructor
         MoneyOrderInfo(const MoneyOrderInfo& other) : Serializable(this)
         {
+            m_amount          = other.m_amount;
             m_blinding_factor = other.m_blinding_factor;
             m_commit_data     = other.m_commit_data;
         }
 
+        // the denomination the money order was signed for, kept so that the
+        // buyer knows which key it has to be checked with
+        unsigned int                                   m_amount          = 0;
         std::string                                    m_blinding_factor = "";
         std::vector<std::pair<CommitData, CommitData>> m_commit_data;
 
@@ -52,6 +56,7 @@ class MoneyOrderInfo : public Serializable<MoneyOrderInfo>
         template<class Archive>
         void serialize(Archive & ar, const unsigned int version)
         {
+            ar & m_amount;
             ar & m_blinding_factor;
             ar & m_commit_data;
         }
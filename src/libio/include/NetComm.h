@@ -27,6 +27,7 @@
 #include <sstream>
 #include <cstdlib>
 #include <cstring>
+#include <functional>
 #include <iostream>
 #include <boost/asio.hpp>
 
@@ -42,6 +43,15 @@ namespace NetComm
 
             std::string ReadAndAcknowledge(tcp::socket& sock1);
             void        WriteAndWaitForAcknowledge( tcp::socket& sock1, std::string str );
+
+            // Length prefixed messages for payloads that do not fit in a single read
+            std::string ReadFramedAndAcknowledge(tcp::socket& sock1);
+            void        WriteFramedAndWaitForAcknowledge( tcp::socket& sock1, const std::string& str );
+
+            // Hands a framed message to consume piece by piece as it arrives, instead of
+            // returning it whole.  The ack is sent once consume has seen all of it.
+            typedef std::function<void(const char* data, size_t length)> Consumer;
+            void        ReadFramedAndAcknowledge(tcp::socket& sock1, const Consumer& consume);
         
         protected:
             boost::asio::io_service* io_service;
@@ -52,6 +62,8 @@ namespace NetComm
     {
         public:
             Server( unsigned short port );
+            // listens on one local address only, e.g. 127.0.0.1
+            Server( const std::string& address, unsigned short port );
             ~Server();
 
             void Start();
@@ -59,6 +71,10 @@ namespace NetComm
             
         protected:
             tcp::acceptor* acceptor;
+
+        private:
+            // runs one connection and keeps the connection metrics
+            void Serve(tcp::socket sock1);
     };
 
     class Client : public NetComm
@@ -69,6 +85,13 @@ namespace NetComm
             void Connect();
             std::string ReadAndAcknowledge();
             void        WriteAndWaitForAcknowledge( std::string str );
+            std::string ReadFramedAndAcknowledge();
+            void        ReadFramedAndAcknowledge( const Consumer& consume );
+            void        WriteFramedAndWaitForAcknowledge( const std::string& str );
+
+            // true if the connection is still open and nothing is waiting to be read,
+            // found out without blocking.  False once the server has closed it.
+            bool        Idle();
 
         protected: 
             tcp::socket* sock;
@@ -0,0 +1,88 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#ifndef PUBLICKEYSET_H_
+#define PUBLICKEYSET_H_
+
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/serialization/map.hpp>
+#include "Serializable.h"
+#include "Utilities.h"
+
+#include <map>
+#include <string>
+#include <utility>
+
+// The bank's public keys, one per denomination and epoch.  A money order is worth the
+// denomination whose key signed it, and can be deposited for as long as the bank still
+// lists that key.
+class PublicKeySet : public Serializable<PublicKeySet>
+{
+    public:
+        PublicKeySet() : Serializable(this) {}
+        ~PublicKeySet() = default;
+
+        // copy constructor
+        PublicKeySet(const PublicKeySet& other) : Serializable(this)
+        {
+            m_epoch = other.m_epoch;
+            m_keys  = other.m_keys;
+        }
+
+        // epoch, denomination
+        typedef std::pair<unsigned int, unsigned int> KeyId;
+
+        // the epoch whose keys the bank signs new money orders with
+        unsigned int m_epoch = 0;
+
+        // maps  key id to  (modulus, exponent) in base 10
+        std::map<KeyId, std::pair<std::string, std::string>> m_keys;
+
+        // names a serialized key set, in hex: the first 16 bytes of its SHA-256.  A client
+        // holding keys with the bank's fingerprint has nothing new to fetch.
+        static std::string Fingerprint(const std::string& serialized)
+        {
+            static const char digits[] = "0123456789abcdef";
+            static const size_t LENGTH = 16;
+
+            std::string hex;
+            for (const unsigned char c : Utilities::Sha256(serialized).substr(0, LENGTH))
+            {
+                hex += digits[c >> 4];
+                hex += digits[c & 0xF];
+            }
+
+            return hex;
+        }
+
+    private:
+        friend class boost::serialization::access;
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version)
+        {
+            ar & m_epoch;
+            ar & m_keys;
+        }
+};
+#endif // PUBLICKEYSET_H_
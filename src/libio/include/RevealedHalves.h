@@ -0,0 +1,58 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#ifndef REVEALEDHALVES_H_
+#define REVEALEDHALVES_H_
+
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include "Serializable.h"
+
+#include <string>
+#include <vector>
+
+// The buyer's answer to the merchant's selector string: the serialized CommitData
+// of the chosen half of every identity string, sent in one message
+class RevealedHalves : public Serializable<RevealedHalves>
+{
+    public:
+        RevealedHalves() : Serializable(this) {}
+        ~RevealedHalves() = default;
+
+        // copy constructor
+        RevealedHalves(const RevealedHalves& other) : Serializable(this)
+        {
+            m_commit_data = other.m_commit_data;
+        }
+
+        std::vector<std::string> m_commit_data;
+
+    private:
+        friend class boost::serialization::access;
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version)
+        {
+            ar & m_commit_data;
+        }
+};
+#endif // REVEALEDHALVES_H_
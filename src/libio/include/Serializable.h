@@ -42,6 +42,12 @@ class Serializable
             tPtr = tPtr_in;
         }
 
+        // an assigned object must keep serializing itself, not the source
+        Serializable& operator=(const Serializable&)
+        {
+            return *this;
+        }
+
         // Serialize Reference: http://stackoverflow.com/questions/3015582/direct-boost-serialization-to-char-array
         std::string Serialize()
         {
@@ -0,0 +1,108 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#ifndef WALLET_H_
+#define WALLET_H_
+
+#include "CoinId.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//! The buyer's coins, in one memory mapped file.  The file starts with an index of
+//! fixed width entries, one per coin, and the coins follow it as they were serialized:
+//!
+//!     "KKWALLET" | version | count | entry 0 ... entry count-1 | coin and info 0 | ...
+//!     entry: id (CoinId::LENGTH bytes) | amount | flags | offset | coin length | info length
+//!
+//! Numbers are big endian.  Opening a wallet maps it and reads nothing else, looking a
+//! coin up reads only its entry and its own bytes, so it takes the same time whether
+//! the wallet holds one coin or thousands.  Marking a coin spent writes its flags in
+//! place.
+/////////////////////////////////////////////////////////////////////////////////////////
+class Wallet
+{
+    public:
+        // a coin to put in a new wallet
+        struct Entry
+        {
+            CoinId       id;
+            unsigned int amount = 0;
+            std::string  coin;      // a serialized Coin
+            std::string  info;      // the serialized MoneyOrderInfo needed to spend it
+            bool         spent  = false;
+        };
+
+        // what the index says about a coin
+        struct IndexEntry
+        {
+            CoinId       id;
+            unsigned int amount;
+            bool         spent;
+        };
+
+        // writes a wallet holding entries to filename, replacing any file there only
+        // once the new one is complete.  Throws std::runtime_error if it cannot.
+        static void Create( const std::string& filename, const std::vector<Entry>& entries );
+
+        // adds entries after the coins already in filename, spent or not, or creates it.
+        // The old wallet stays in place until the new one is complete.  Throws
+        // std::runtime_error, and leaves the file alone, if it is there but is not a wallet.
+        static void Append( const std::string& filename, const std::vector<Entry>& entries );
+
+        // maps filename, throws std::runtime_error if it is not a wallet
+        explicit Wallet( const std::string& filename );
+        ~Wallet();
+
+        size_t Size() const;
+
+        // each throws std::out_of_range for a coin the wallet does not hold, and
+        // std::runtime_error if the index points outside the file
+        IndexEntry  Index( const size_t i ) const;
+        std::string CoinData( const size_t i ) const;
+        std::string InfoData( const size_t i ) const;
+
+        // the first coin that has not been spent, Size() if there is none
+        size_t FirstUnspent() const;
+
+        // records that coin i has been spent, on disk before it returns
+        void MarkSpent( const size_t i );
+
+    private:
+        Wallet( const Wallet& ) = delete;
+        Wallet& operator=( const Wallet& ) = delete;
+
+        const unsigned char* EntryAt( const size_t i ) const;
+        std::string          Bytes( const uint64_t offset, const uint64_t length ) const;
+
+        std::string    m_filename;
+        int            m_fd;
+        unsigned char* m_data;
+        size_t         m_length;
+        size_t         m_count;
+};
+
+#endif // WALLET_H_
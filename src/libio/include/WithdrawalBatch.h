@@ -0,0 +1,114 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#ifndef WITHDRAWALBATCH_H_
+#define WITHDRAWALBATCH_H_
+
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include "Serializable.h"
+
+#include <string>
+#include <vector>
+
+// The messages of a SIGN MONEY ORDERS session, which withdraws several coins at once.
+// The buyer makes numMoneyOrders money orders per coin and the money orders of coin k
+// sit at [k*numMoneyOrders, (k+1)*numMoneyOrders) in every list below.
+
+// the blinded full domain hashes of every money order, base 10
+class BlindedMoneyOrders : public Serializable<BlindedMoneyOrders>
+{
+    public:
+        BlindedMoneyOrders() : Serializable(this) {}
+        ~BlindedMoneyOrders() = default;
+
+        // copy constructor
+        BlindedMoneyOrders(const BlindedMoneyOrders& other) : Serializable(this)
+        {
+            m_money_orders = other.m_money_orders;
+        }
+
+        std::vector<std::string> m_money_orders;
+
+    private:
+        friend class boost::serialization::access;
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version)
+        {
+            ar & m_money_orders;
+        }
+};
+
+// the money orders the bank asked to see opened, in order: each serialized
+// MoneyOrderInfo and the serialized MoneyOrder it belongs to
+class OpenedMoneyOrders : public Serializable<OpenedMoneyOrders>
+{
+    public:
+        OpenedMoneyOrders() : Serializable(this) {}
+        ~OpenedMoneyOrders() = default;
+
+        // copy constructor
+        OpenedMoneyOrders(const OpenedMoneyOrders& other) : Serializable(this)
+        {
+            m_info         = other.m_info;
+            m_money_orders = other.m_money_orders;
+        }
+
+        std::vector<std::string> m_info;
+        std::vector<std::string> m_money_orders;
+
+    private:
+        friend class boost::serialization::access;
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version)
+        {
+            ar & m_info;
+            ar & m_money_orders;
+        }
+};
+
+// the bank's blind signatures, one per coin and in coin order, base 10.  Empty when
+// the bank refused the withdrawal.
+class SignedMoneyOrders : public Serializable<SignedMoneyOrders>
+{
+    public:
+        SignedMoneyOrders() : Serializable(this) {}
+        ~SignedMoneyOrders() = default;
+
+        // copy constructor
+        SignedMoneyOrders(const SignedMoneyOrders& other) : Serializable(this)
+        {
+            m_signatures = other.m_signatures;
+        }
+
+        std::vector<std::string> m_signatures;
+
+    private:
+        friend class boost::serialization::access;
+        template<class Archive>
+        void serialize(Archive & ar, const unsigned int version)
+        {
+            ar & m_signatures;
+        }
+};
+#endif // WITHDRAWALBATCH_H_
@@ -0,0 +1,357 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#include "Log.h"
+#include "Metrics.h"
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <thread>
+
+namespace
+{
+    // records the ring holds before new ones are dropped, a power of two
+    const size_t RING_SIZE = 4096;
+
+    // how long the writer sleeps when the ring is empty
+    const std::chrono::milliseconds IDLE_INTERVAL(10);
+
+    Metrics::Counter& records_dropped = Metrics::GetCounter("log_dropped_total", "Log records dropped because the ring was full");
+
+    struct Entry
+    {
+        std::chrono::system_clock::time_point time;
+        Log::Level                            level;
+        std::string                           text;
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // Bounded queue after Dmitry Vyukov's: every slot carries a sequence number that
+    // says whether it is free for the producer at a position or full for the consumer.
+    // Producers claim positions with a compare and swap, there is a single consumer.
+    /////////////////////////////////////////////////////////////////////////////////////
+    class Ring
+    {
+        public:
+            Ring() : m_enqueue_position(0), m_dequeue_position(0)
+            {
+                for (size_t i = 0; i < RING_SIZE; ++i)
+                {
+                    m_slots[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            // false, and entry untouched, when the ring is full
+            bool TryPush( Entry& entry )
+            {
+                size_t position = m_enqueue_position.load(std::memory_order_relaxed);
+                while (true)
+                {
+                    Slot& slot = m_slots[position & (RING_SIZE - 1)];
+                    size_t sequence = slot.sequence.load(std::memory_order_acquire);
+                    intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+                    if (difference == 0)
+                    {
+                        if (m_enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                        {
+                            slot.entry = std::move(entry);
+                            slot.sequence.store(position + 1, std::memory_order_release);
+                            return true;
+                        }
+                    }
+                    else if (difference < 0)
+                    {
+                        return false;
+                    }
+                    else
+                    {
+                        position = m_enqueue_position.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            // only called by the writer thread
+            bool TryPop( Entry& entry )
+            {
+                Slot& slot = m_slots[m_dequeue_position & (RING_SIZE - 1)];
+                size_t sequence = slot.sequence.load(std::memory_order_acquire);
+                if (sequence != m_dequeue_position + 1)
+                {
+                    return false;
+                }
+
+                entry = std::move(slot.entry);
+                slot.sequence.store(m_dequeue_position + RING_SIZE, std::memory_order_release);
+                ++m_dequeue_position;
+                return true;
+            }
+
+            // positions handed out to producers so far
+            size_t Pushed() const
+            {
+                return m_enqueue_position.load(std::memory_order_acquire);
+            }
+
+        private:
+            struct Slot
+            {
+                std::atomic<size_t> sequence;
+                Entry               entry;
+            };
+
+            Slot                m_slots[RING_SIZE];
+            std::atomic<size_t> m_enqueue_position;
+            size_t              m_dequeue_position;
+    };
+
+    const char* LevelName( const Log::Level level )
+    {
+        switch (level)
+        {
+            case Log::Level::DEBUG:   return "DEBUG";
+            case Log::Level::INFO:    return "INFO";
+            case Log::Level::WARNING: return "WARNING";
+            case Log::Level::ERROR:   return "ERROR";
+        }
+
+        return "";
+    }
+
+    // 2015-04-01T12:00:00.123Z
+    std::string Timestamp( const std::chrono::system_clock::time_point time )
+    {
+        std::time_t seconds = std::chrono::system_clock::to_time_t(time);
+        long long   millis  = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count() % 1000;
+
+        struct tm utc;
+        gmtime_r(&seconds, &utc);
+
+        char buffer[32];
+        size_t length = std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &utc);
+        std::snprintf(buffer + length, sizeof(buffer) - length, ".%03lldZ", millis);
+        return buffer;
+    }
+
+    // values are quoted when they would not read back as a single token
+    std::string Quote( const std::string& value )
+    {
+        bool plain = !value.empty();
+        for (const unsigned char c : value)
+        {
+            if (c <= ' ' || c >= 0x7F || c == '"' || c == '=' || c == '\\')
+            {
+                plain = false;
+                break;
+            }
+        }
+
+        if (plain)
+        {
+            return value;
+        }
+
+        std::string quoted = "\"";
+        for (const unsigned char c : value)
+        {
+            if (c == '"' || c == '\\')
+            {
+                quoted += '\\';
+                quoted += c;
+            }
+            else if (c < ' ' || c >= 0x7F)
+            {
+                char escape[5];
+                std::snprintf(escape, sizeof(escape), "\\x%02x", c);
+                quoted += escape;
+            }
+            else
+            {
+                quoted += c;
+            }
+        }
+        quoted += '"';
+
+        return quoted;
+    }
+
+    class Logger
+    {
+        public:
+            Logger()
+                : level( static_cast<int>(Log::Level::INFO) ),
+                  info( stdout ),
+                  warnings( stderr ),
+                  written( 0 )
+            {
+                std::thread(&Logger::Writer, this).detach();
+            }
+
+            void Push( Entry& entry )
+            {
+                if (!ring.TryPush(entry))
+                {
+                    records_dropped.Increment();
+                }
+            }
+
+            void Flush()
+            {
+                size_t pushed = ring.Pushed();
+                while (written.load(std::memory_order_acquire) < pushed)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+
+            std::atomic<int>   level;
+            std::atomic<FILE*> info;
+            std::atomic<FILE*> warnings;
+
+        private:
+            void Writer()
+            {
+                Entry entry;
+                std::string infoLines;
+                std::string warningLines;
+
+                while (true)
+                {
+                    size_t count = 0;
+                    while (count < RING_SIZE && ring.TryPop(entry))
+                    {
+                        std::string& lines = (entry.level >= Log::Level::WARNING) ? warningLines : infoLines;
+                        lines += Timestamp(entry.time);
+                        lines += ' ';
+                        lines += LevelName(entry.level);
+                        lines += ' ';
+                        lines += entry.text;
+                        lines += '\n';
+                        ++count;
+                    }
+
+                    if (count == 0)
+                    {
+                        std::this_thread::sleep_for(IDLE_INTERVAL);
+                        continue;
+                    }
+
+                    Write(info.load(), infoLines);
+                    Write(warnings.load(), warningLines);
+                    written.fetch_add(count, std::memory_order_release);
+                }
+            }
+
+            static void Write( FILE* out, std::string& lines )
+            {
+                if (!lines.empty())
+                {
+                    std::fwrite(lines.data(), 1, lines.size(), out);
+                    std::fflush(out);
+                    lines.clear();
+                }
+            }
+
+            Ring                ring;
+            std::atomic<size_t> written;
+    };
+
+    // never destroyed, the writer thread runs until the process exits
+    Logger& TheLogger()
+    {
+        static Logger* logger = new Logger();
+        return *logger;
+    }
+}
+
+void Log::SetLevel( const Level level )
+{
+    TheLogger().level.store(static_cast<int>(level));
+}
+
+bool Log::Enabled( const Level level )
+{
+    return static_cast<int>(level) >= TheLogger().level.load(std::memory_order_relaxed);
+}
+
+void Log::SetStreams( FILE* info, FILE* warnings )
+{
+    TheLogger().info.store(info);
+    TheLogger().warnings.store(warnings);
+}
+
+void Log::Flush()
+{
+    TheLogger().Flush();
+}
+
+Log::Record::Record( const Level level, const char* message )
+    : enabled( Enabled(level) ),
+      level( level )
+{
+    if (enabled)
+    {
+        time = std::chrono::system_clock::now();
+        text = message;
+    }
+}
+
+Log::Record::Record( Record&& other )
+    : enabled( other.enabled ),
+      level( other.level ),
+      time( other.time ),
+      text( std::move(other.text) )
+{
+    other.enabled = false;
+}
+
+Log::Record::~Record()
+{
+    if (enabled)
+    {
+        Entry entry;
+        entry.time  = time;
+        entry.level = level;
+        entry.text  = std::move(text);
+        TheLogger().Push(entry);
+    }
+}
+
+Log::Record& Log::Record::Field( const char* key, const std::string& value )
+{
+    if (enabled)
+    {
+        text += ' ';
+        text += key;
+        text += '=';
+        text += Quote(value);
+    }
+
+    return *this;
+}
+
+Log::Record& Log::Record::Field( const char* key, const char* value )
+{
+    return Field( key, std::string(value) );
+}
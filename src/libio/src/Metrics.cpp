@@ -0,0 +1,379 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+const unsigned int Metrics::Histogram::SUB_BUCKET_BITS;
+const unsigned int Metrics::Histogram::SUB_BUCKETS;
+const unsigned int Metrics::Histogram::MAX_EXPONENT;
+const uint64_t     Metrics::Histogram::MAX_VALUE;
+const unsigned int Metrics::Histogram::NUM_BUCKETS;
+
+namespace
+{
+    // every metric is exposed under this prefix
+    const std::string PREFIX = "koolkash_";
+
+    // histogram buckets are exposed at every second power of two nanoseconds, from
+    // about a microsecond to about four and a half minutes
+    const unsigned int FIRST_EXPOSED_EXPONENT = 10;
+    const unsigned int LAST_EXPOSED_EXPONENT  = 38;
+
+    // threads take shards in turn, the first time they record anything
+    unsigned int ThreadShard()
+    {
+        static std::atomic<unsigned int> next_shard(0);
+        thread_local unsigned int shard = next_shard.fetch_add(1, std::memory_order_relaxed) % Metrics::NUM_SHARDS;
+        return shard;
+    }
+
+    enum class Kind
+    {
+        COUNTER,
+        GAUGE,
+        HISTOGRAM
+    };
+
+    // the metrics sharing a name, one per label set
+    struct Family
+    {
+        Kind        kind;
+        std::string help;
+
+        std::map<std::string, std::unique_ptr<Metrics::Counter>>   counters;
+        std::map<std::string, std::unique_ptr<Metrics::Gauge>>     gauges;
+        std::map<std::string, std::unique_ptr<Metrics::Histogram>> histograms;
+    };
+
+    struct Registry
+    {
+        std::mutex                    mutex;
+        std::map<std::string, Family> families;
+    };
+
+    // never destroyed, detached threads may still be recording while the process exits
+    Registry& TheRegistry()
+    {
+        static Registry* registry = new Registry();
+        return *registry;
+    }
+
+    // bank_command_seconds{command="x"} -> bank_command_seconds and {command="x"};
+    // returns the family the metric belongs to, creating it if need be
+    Family& FindFamily( Registry& registry, const std::string& name, const std::string& help,
+                        const Kind kind, std::string& labels )
+    {
+        size_t brace = name.find('{');
+        std::string familyName = name.substr(0, brace);
+        labels = (brace == std::string::npos) ? "" : name.substr(brace);
+
+        auto it = registry.families.find(familyName);
+        if (it == registry.families.end())
+        {
+            Family& family = registry.families[familyName];
+            family.kind = kind;
+            family.help = help;
+            return family;
+        }
+
+        if (it->second.kind != kind)
+        {
+            throw std::logic_error("Metric " + familyName + " is already registered as another kind");
+        }
+
+        return it->second;
+    }
+
+    // {command="x"} and le="0.5" -> {command="x",le="0.5"}
+    std::string AddLabel( const std::string& labels, const std::string& label )
+    {
+        if (labels.empty())
+        {
+            return "{" + label + "}";
+        }
+
+        return labels.substr(0, labels.size() - 1) + "," + label + "}";
+    }
+
+    std::string Seconds( const double nanoseconds )
+    {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.9g", nanoseconds / 1e9);
+        return buffer;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// Counter
+
+Metrics::Counter::Counter()
+{
+    for (auto& shard : m_shards)
+    {
+        shard.value.store(0, std::memory_order_relaxed);
+    }
+}
+
+void Metrics::Counter::Increment( const uint64_t n )
+{
+    m_shards[ThreadShard()].value.fetch_add(n, std::memory_order_relaxed);
+}
+
+uint64_t Metrics::Counter::Value() const
+{
+    uint64_t value = 0;
+    for (const auto& shard : m_shards)
+    {
+        value += shard.value.load(std::memory_order_relaxed);
+    }
+
+    return value;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// Histogram
+
+Metrics::Histogram::Histogram()
+{
+    for (auto& shard : m_shards)
+    {
+        for (auto& bucket : shard.buckets)
+        {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        shard.sum.store(0, std::memory_order_relaxed);
+    }
+}
+
+void Metrics::Histogram::Record( const uint64_t nanoseconds )
+{
+    Shard& shard = m_shards[ThreadShard()];
+    shard.buckets[BucketIndex(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+void Metrics::Histogram::Record( const std::chrono::steady_clock::duration elapsed )
+{
+    Record( static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) );
+}
+
+Metrics::HistogramSnapshot Metrics::Histogram::Snapshot() const
+{
+    HistogramSnapshot snapshot;
+    snapshot.buckets.assign(NUM_BUCKETS, 0);
+
+    for (const auto& shard : m_shards)
+    {
+        for (unsigned int i = 0; i < NUM_BUCKETS; ++i)
+        {
+            uint64_t n = shard.buckets[i].load(std::memory_order_relaxed);
+            snapshot.buckets[i] += n;
+            snapshot.count      += n;
+        }
+        snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+
+    return snapshot;
+}
+
+unsigned int Metrics::Histogram::BucketIndex( const uint64_t value )
+{
+    uint64_t v = (value > MAX_VALUE) ? MAX_VALUE : value;
+    if (v < SUB_BUCKETS)
+    {
+        return v;
+    }
+
+    // the top SUB_BUCKET_BITS bits below the leading one pick the sub bucket
+    unsigned int shift = (63 - __builtin_clzll(v)) - SUB_BUCKET_BITS;
+    return SUB_BUCKETS * (shift + 1) + ((v >> shift) & (SUB_BUCKETS - 1));
+}
+
+uint64_t Metrics::Histogram::BucketLowerBound( const unsigned int index )
+{
+    if (index < SUB_BUCKETS)
+    {
+        return index;
+    }
+
+    unsigned int shift = index / SUB_BUCKETS - 1;
+    return static_cast<uint64_t>(SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+}
+
+uint64_t Metrics::Histogram::BucketUpperBound( const unsigned int index )
+{
+    if (index < SUB_BUCKETS)
+    {
+        return index;
+    }
+
+    unsigned int shift = index / SUB_BUCKETS - 1;
+    return BucketLowerBound(index) + (1ULL << shift) - 1;
+}
+
+uint64_t Metrics::HistogramSnapshot::Percentile( const double p ) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    // nearest rank
+    uint64_t rank = static_cast<uint64_t>(std::ceil(p * count));
+    rank = std::max<uint64_t>(1, std::min<uint64_t>(rank, count));
+
+    uint64_t seen = 0;
+    for (unsigned int i = 0; i < buckets.size(); ++i)
+    {
+        seen += buckets[i];
+        if (seen >= rank)
+        {
+            return Histogram::BucketUpperBound(i);
+        }
+    }
+
+    return Histogram::MAX_VALUE;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+// Registry
+
+Metrics::Counter& Metrics::GetCounter( const std::string& name, const std::string& help )
+{
+    Registry& registry = TheRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    std::string labels;
+    std::unique_ptr<Counter>& counter = FindFamily(registry, name, help, Kind::COUNTER, labels).counters[labels];
+    if (!counter)
+    {
+        counter.reset( new Counter() );
+    }
+
+    return *counter;
+}
+
+Metrics::Gauge& Metrics::GetGauge( const std::string& name, const std::string& help )
+{
+    Registry& registry = TheRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    std::string labels;
+    std::unique_ptr<Gauge>& gauge = FindFamily(registry, name, help, Kind::GAUGE, labels).gauges[labels];
+    if (!gauge)
+    {
+        gauge.reset( new Gauge() );
+    }
+
+    return *gauge;
+}
+
+Metrics::Histogram& Metrics::GetHistogram( const std::string& name, const std::string& help )
+{
+    Registry& registry = TheRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    std::string labels;
+    std::unique_ptr<Histogram>& histogram = FindFamily(registry, name, help, Kind::HISTOGRAM, labels).histograms[labels];
+    if (!histogram)
+    {
+        histogram.reset( new Histogram() );
+    }
+
+    return *histogram;
+}
+
+std::string Metrics::Exposition()
+{
+    Registry& registry = TheRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    std::stringstream out;
+    for (const auto& entry : registry.families)
+    {
+        const std::string name   = PREFIX + entry.first;
+        const Family&     family = entry.second;
+
+        out << "# HELP " << name << " " << family.help << "\n";
+
+        switch (family.kind)
+        {
+            case Kind::COUNTER:
+                out << "# TYPE " << name << " counter\n";
+                for (const auto& counter : family.counters)
+                {
+                    out << name << counter.first << " " << counter.second->Value() << "\n";
+                }
+                break;
+
+            case Kind::GAUGE:
+                out << "# TYPE " << name << " gauge\n";
+                for (const auto& gauge : family.gauges)
+                {
+                    out << name << gauge.first << " " << gauge.second->Value() << "\n";
+                }
+                break;
+
+            case Kind::HISTOGRAM:
+                out << "# TYPE " << name << " histogram\n";
+                for (const auto& histogram : family.histograms)
+                {
+                    const std::string&      labels   = histogram.first;
+                    const HistogramSnapshot snapshot = histogram.second->Snapshot();
+
+                    // cumulative counts of the values up to each exposed bound.  Prometheus
+                    // reads le as inclusive, so the bound is the last value the buckets below
+                    // 2^e hold, 2^e - 1, as 2^e itself starts the next bucket.
+                    uint64_t     below = 0;
+                    unsigned int index = 0;
+                    for (unsigned int e = FIRST_EXPOSED_EXPONENT; e <= LAST_EXPOSED_EXPONENT; e += 2)
+                    {
+                        for (; index < Histogram::BucketIndex(1ULL << e); ++index)
+                        {
+                            below += snapshot.buckets[index];
+                        }
+
+                        const uint64_t bound = Histogram::BucketUpperBound(index - 1);
+                        out << name << "_bucket" << AddLabel(labels, "le=\"" + Seconds(bound) + "\"")
+                            << " " << below << "\n";
+                    }
+
+                    out << name << "_bucket" << AddLabel(labels, "le=\"+Inf\"") << " " << snapshot.count << "\n";
+                    out << name << "_sum" << labels << " " << Seconds(snapshot.sum) << "\n";
+                    out << name << "_count" << labels << " " << snapshot.count << "\n";
+                }
+                break;
+        }
+    }
+
+    return out.str();
+}
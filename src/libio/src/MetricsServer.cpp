@@ -0,0 +1,63 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#include "MetricsServer.h"
+#include "Log.h"
+#include "Metrics.h"
+
+#include <thread>
+
+Metrics::MetricsServer::MetricsServer( unsigned short port )
+    : Server( "127.0.0.1", port )
+{
+}
+
+void Metrics::MetricsServer::run(tcp::socket sock1)
+{
+    try
+    {
+        // whatever was asked for, the answer is the same
+        char request[4096];
+        sock1.read_some( boost::asio::buffer(request, sizeof(request)) );
+
+        std::string body = Exposition();
+
+        std::stringstream response;
+        response << "HTTP/1.0 200 OK\r\n"
+                 << "Content-Type: text/plain; version=0.0.4\r\n"
+                 << "Content-Length: " << body.size() << "\r\n"
+                 << "\r\n"
+                 << body;
+
+        boost::asio::write( sock1, boost::asio::buffer(response.str()) );
+    }
+    catch (std::exception& e)
+    {
+        Log::Warning("exception").Field("in", "Metrics::MetricsServer::run()").Field("error", e.what());
+    }
+}
+
+void Metrics::StartMetricsServer( unsigned short port )
+{
+    std::thread(&MetricsServer::Start, new MetricsServer(port)).detach();
+}
@@ -25,16 +25,50 @@
 #include <thread>
 #include <boost/asio.hpp>
 #include <NetComm.h>
+#include "Metrics.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
+#include <stdexcept>
 #include <utility>
+#include <vector>
 
 using boost::asio::ip::tcp;
 
 namespace
 {
     const unsigned int MAX_LENGTH = 65536;
+
+    // framed messages start with their length as a big endian 64 bit number
+    const size_t   FRAME_HEADER_LENGTH = 8;
+    const uint64_t MAX_FRAME_LENGTH    = 1ULL << 30;
+
+    // acknowledgements are counted too, they are on the wire like everything else
+    Metrics::Counter& bytes_received = Metrics::GetCounter("netcomm_bytes_received_total", "Bytes read from sockets");
+    Metrics::Counter& bytes_sent     = Metrics::GetCounter("netcomm_bytes_sent_total", "Bytes written to sockets");
+
+    Metrics::Counter& connections_accepted = Metrics::GetCounter("netcomm_connections_accepted_total", "Connections accepted by the server");
+    Metrics::Gauge&   connections_open     = Metrics::GetGauge("netcomm_connections_open", "Connections the server is serving now");
+
+    // reads a frame header and returns the length of the message that follows
+    uint64_t ReadFrameHeader(tcp::socket& sock1, unsigned char (&header)[FRAME_HEADER_LENGTH])
+    {
+        boost::asio::read( sock1, boost::asio::buffer(header, FRAME_HEADER_LENGTH) );
+
+        uint64_t length = 0;
+        for (size_t i = 0; i < FRAME_HEADER_LENGTH; ++i)
+        {
+            length = (length << 8) | header[i];
+        }
+
+        if (length > MAX_FRAME_LENGTH)
+        {
+            throw std::length_error("Framed message is too long");
+        }
+
+        return length;
+    }
 }
 
 NetComm::NetComm::NetComm()
@@ -54,11 +88,13 @@ std::string NetComm::NetComm::ReadAndAcknowledge(tcp::socket& sock1)
 {
     char data[MAX_LENGTH];
     size_t length_sent = sock1.read_some( boost::asio::buffer(data, MAX_LENGTH) );
+    bytes_received.Increment(length_sent);
 
     std::string ret_str(data, length_sent);
 
     // write back an ack
     boost::asio::write( sock1, boost::asio::buffer(data, length_sent) );
+    bytes_sent.Increment(length_sent);
 
     return ret_str;
 }
@@ -66,17 +102,84 @@ std::string NetComm::NetComm::ReadAndAcknowledge(tcp::socket& sock1)
 void NetComm::NetComm::WriteAndWaitForAcknowledge( tcp::socket& sock1, std::string str )
 {
     boost::asio::write( sock1, boost::asio::buffer(str.c_str(), str.size()) );
+    bytes_sent.Increment(str.size());
 
     // wait for an ack
     char ack[str.size()];
-    sock1.read_some( boost::asio::buffer(ack, str.size()) );
+    bytes_received.Increment( sock1.read_some( boost::asio::buffer(ack, str.size()) ) );
 }
-        
+
+std::string NetComm::NetComm::ReadFramedAndAcknowledge(tcp::socket& sock1)
+{
+    unsigned char header[FRAME_HEADER_LENGTH];
+    uint64_t length = ReadFrameHeader(sock1, header);
+
+    std::string ret_str(length, '\0');
+    boost::asio::read( sock1, boost::asio::buffer(&ret_str[0], length) );
+
+    // write back the header as the ack
+    boost::asio::write( sock1, boost::asio::buffer(header, FRAME_HEADER_LENGTH) );
+
+    bytes_received.Increment(FRAME_HEADER_LENGTH + length);
+    bytes_sent.Increment(FRAME_HEADER_LENGTH);
+
+    return ret_str;
+}
+
+void NetComm::NetComm::ReadFramedAndAcknowledge(tcp::socket& sock1, const Consumer& consume)
+{
+    unsigned char header[FRAME_HEADER_LENGTH];
+    uint64_t length = ReadFrameHeader(sock1, header);
+
+    // pass on whatever the socket has, at most a buffer at a time
+    std::vector<char> data(std::min<uint64_t>(length, MAX_LENGTH));
+    for (uint64_t remaining = length; remaining > 0; )
+    {
+        size_t received = sock1.read_some( boost::asio::buffer(data.data(), std::min<uint64_t>(remaining, data.size())) );
+        consume(data.data(), received);
+        remaining -= received;
+    }
+
+    // write back the header as the ack
+    boost::asio::write( sock1, boost::asio::buffer(header, FRAME_HEADER_LENGTH) );
+
+    bytes_received.Increment(FRAME_HEADER_LENGTH + length);
+    bytes_sent.Increment(FRAME_HEADER_LENGTH);
+}
+
+void NetComm::NetComm::WriteFramedAndWaitForAcknowledge( tcp::socket& sock1, const std::string& str )
+{
+    unsigned char header[FRAME_HEADER_LENGTH];
+    uint64_t length = str.size();
+    for (size_t i = FRAME_HEADER_LENGTH; i > 0; --i)
+    {
+        header[i - 1] = length & 0xFF;
+        length >>= 8;
+    }
+
+    std::vector<boost::asio::const_buffer> buffers;
+    buffers.push_back( boost::asio::buffer(header, FRAME_HEADER_LENGTH) );
+    buffers.push_back( boost::asio::buffer(str.data(), str.size()) );
+    boost::asio::write( sock1, buffers );
+
+    // wait for an ack
+    unsigned char ack[FRAME_HEADER_LENGTH];
+    boost::asio::read( sock1, boost::asio::buffer(ack, FRAME_HEADER_LENGTH) );
+
+    bytes_sent.Increment(FRAME_HEADER_LENGTH + str.size());
+    bytes_received.Increment(FRAME_HEADER_LENGTH);
+}
+
 NetComm::Server::Server( unsigned short port )
 {
     acceptor = new tcp::acceptor( *io_service, tcp::endpoint( tcp::v4(), port));
 }
 
+NetComm::Server::Server( const std::string& address, unsigned short port )
+{
+    acceptor = new tcp::acceptor( *io_service, tcp::endpoint( boost::asio::ip::address::from_string(address), port));
+}
+
 NetComm::Server::~Server() 
 {
     if (acceptor != NULL)
@@ -91,10 +194,23 @@ void NetComm::Server::Start()
     {
         tcp::socket sock1(*io_service);
         acceptor->accept( sock1 );
-        std::thread myThread(&Server::run,this,std::move(sock1));
-        myThread.join();
+
+        // each connection gets its own thread so that long lived clients,
+        // like a merchant's pooled bank connections, do not block the others
+        std::thread myThread(&Server::Serve,this,std::move(sock1));
+        myThread.detach();
     }
 }
+
+void NetComm::Server::Serve(tcp::socket sock1)
+{
+    connections_accepted.Increment();
+    connections_open.Add(1);
+
+    run(std::move(sock1));
+
+    connections_open.Add(-1);
+}
             
 NetComm::Client::Client( const char* host, const char* port )
     : server(host),
@@ -132,4 +248,38 @@ void NetComm::Client::WriteAndWaitForAcknowledge( std::string str )
     NetComm::NetComm::WriteAndWaitForAcknowledge( *(this->sock), str );
 }
 
+std::string NetComm::Client::ReadFramedAndAcknowledge()
+{
+    return NetComm::NetComm::ReadFramedAndAcknowledge(*(this->sock));
+}
+
+void NetComm::Client::ReadFramedAndAcknowledge( const Consumer& consume )
+{
+    NetComm::NetComm::ReadFramedAndAcknowledge( *(this->sock), consume );
+}
+
+void NetComm::Client::WriteFramedAndWaitForAcknowledge( const std::string& str )
+{
+    NetComm::NetComm::WriteFramedAndWaitForAcknowledge( *(this->sock), str );
+}
+
+bool NetComm::Client::Idle()
+{
+    boost::system::error_code error;
+    sock->non_blocking(true, error);
+    if (error)
+    {
+        return false;
+    }
+
+    // a closed connection reads end of file, an idle one has nothing to read yet
+    char byte;
+    size_t received = sock->receive(boost::asio::buffer(&byte, 1), tcp::socket::message_peek, error);
+
+    boost::system::error_code ignored;
+    sock->non_blocking(false, ignored);
+
+    return received == 0 && error == boost::asio::error::would_block;
+}
+
 
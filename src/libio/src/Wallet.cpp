@@ -0,0 +1,276 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#include "Wallet.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    // "KKWALLET" | version | count
+    const char     MAGIC[]       = "KKWALLET";
+    const size_t   MAGIC_LENGTH  = 8;
+    const uint32_t VERSION       = 1;
+    const size_t   HEADER_LENGTH = MAGIC_LENGTH + 4 + 4;
+
+    // id | amount | flags | offset | coin length | info length
+    const size_t   AMOUNT_OFFSET      = CoinId::LENGTH;
+    const size_t   FLAGS_OFFSET       = AMOUNT_OFFSET + 4;
+    const size_t   DATA_OFFSET        = FLAGS_OFFSET + 4;
+    const size_t   COIN_LENGTH_OFFSET = DATA_OFFSET + 8;
+    const size_t   INFO_LENGTH_OFFSET = COIN_LENGTH_OFFSET + 4;
+    const size_t   ENTRY_LENGTH       = INFO_LENGTH_OFFSET + 4;
+
+    const uint32_t FLAG_SPENT = 1;
+
+    void PutNumber( std::string& out, const uint64_t value, const size_t length )
+    {
+        for (size_t i = length; i > 0; --i)
+        {
+            out.push_back(static_cast<char>((value >> (8*(i - 1))) & 0xFF));
+        }
+    }
+
+    uint64_t GetNumber( const unsigned char* in, const size_t length )
+    {
+        uint64_t value = 0;
+        for (size_t i = 0; i < length; ++i)
+        {
+            value = (value << 8) | in[i];
+        }
+
+        return value;
+    }
+}
+
+void Wallet::Create( const std::string& filename, const std::vector<Entry>& entries )
+{
+    std::string buffer(MAGIC, MAGIC_LENGTH);
+    PutNumber(buffer, VERSION, 4);
+    PutNumber(buffer, entries.size(), 4);
+
+    uint64_t offset = HEADER_LENGTH + entries.size() * ENTRY_LENGTH;
+    for (const auto& entry : entries)
+    {
+        buffer += entry.id.Bytes();
+        PutNumber(buffer, entry.amount, 4);
+        PutNumber(buffer, entry.spent ? FLAG_SPENT : 0, 4);
+        PutNumber(buffer, offset, 8);
+        PutNumber(buffer, entry.coin.size(), 4);
+        PutNumber(buffer, entry.info.size(), 4);
+        offset += entry.coin.size() + entry.info.size();
+    }
+
+    buffer.reserve(offset);
+    for (const auto& entry : entries)
+    {
+        buffer += entry.coin;
+        buffer += entry.info;
+    }
+
+    // write a private copy next to the real file and move it into place, so that a
+    // crash never leaves a half written wallet behind
+    std::string tmp_filename = filename + ".tmp";
+    int fd = open(tmp_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Unable to write wallet " + tmp_filename);
+    }
+
+    size_t written = 0;
+    while (written < buffer.size())
+    {
+        ssize_t n = write(fd, buffer.data() + written, buffer.size() - written);
+        if (n < 0)
+        {
+            break;
+        }
+        written += n;
+    }
+
+    bool synced = (written == buffer.size()) && (fsync(fd) == 0);
+    close(fd);
+
+    if (!synced || rename(tmp_filename.c_str(), filename.c_str()) != 0)
+    {
+        unlink(tmp_filename.c_str());
+        throw std::runtime_error("Unable to write wallet " + filename);
+    }
+}
+
+void Wallet::Append( const std::string& filename, const std::vector<Entry>& entries )
+{
+    std::vector<Entry> all;
+    if (access(filename.c_str(), F_OK) == 0)
+    {
+        Wallet wallet(filename);
+        for (size_t i = 0; i < wallet.Size(); ++i)
+        {
+            const IndexEntry index = wallet.Index(i);
+
+            Entry entry;
+            entry.id     = index.id;
+            entry.amount = index.amount;
+            entry.spent  = index.spent;
+            entry.coin   = wallet.CoinData(i);
+            entry.info   = wallet.InfoData(i);
+            all.push_back(entry);
+        }
+    }
+
+    all.insert(all.end(), entries.begin(), entries.end());
+    Create(filename, all);
+}
+
+Wallet::Wallet( const std::string& filename )
+    : m_filename( filename ),
+      m_fd( -1 ),
+      m_data( NULL ),
+      m_length( 0 ),
+      m_count( 0 )
+{
+    m_fd = open(filename.c_str(), O_RDWR);
+    struct stat status;
+    if (m_fd < 0 || fstat(m_fd, &status) != 0)
+    {
+        if (m_fd >= 0)
+        {
+            close(m_fd);
+        }
+        throw std::runtime_error("Unable to open wallet " + filename);
+    }
+
+    m_length = status.st_size;
+    void* data = (m_length < HEADER_LENGTH) ? MAP_FAILED
+                                            : mmap(NULL, m_length, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (data == MAP_FAILED)
+    {
+        close(m_fd);
+        throw std::runtime_error(filename + " is not a wallet");
+    }
+    m_data = static_cast<unsigned char*>(data);
+
+    m_count = GetNumber(m_data + MAGIC_LENGTH + 4, 4);
+    if (std::memcmp(m_data, MAGIC, MAGIC_LENGTH) != 0 ||
+        GetNumber(m_data + MAGIC_LENGTH, 4) != VERSION ||
+        m_count > (m_length - HEADER_LENGTH) / ENTRY_LENGTH)
+    {
+        munmap(m_data, m_length);
+        close(m_fd);
+        throw std::runtime_error(filename + " is not a wallet");
+    }
+}
+
+Wallet::~Wallet()
+{
+    munmap(m_data, m_length);
+    close(m_fd);
+}
+
+size_t Wallet::Size() const
+{
+    return m_count;
+}
+
+Wallet::IndexEntry Wallet::Index( const size_t i ) const
+{
+    const unsigned char* entry = EntryAt(i);
+
+    IndexEntry index;
+    index.id     = CoinId(std::string(reinterpret_cast<const char*>(entry), CoinId::LENGTH));
+    index.amount = GetNumber(entry + AMOUNT_OFFSET, 4);
+    index.spent  = (GetNumber(entry + FLAGS_OFFSET, 4) & FLAG_SPENT) != 0;
+    return index;
+}
+
+std::string Wallet::CoinData( const size_t i ) const
+{
+    const unsigned char* entry = EntryAt(i);
+    return Bytes(GetNumber(entry + DATA_OFFSET, 8), GetNumber(entry + COIN_LENGTH_OFFSET, 4));
+}
+
+std::string Wallet::InfoData( const size_t i ) const
+{
+    // the info follows the coin
+    const unsigned char* entry = EntryAt(i);
+    return Bytes(GetNumber(entry + DATA_OFFSET, 8) + GetNumber(entry + COIN_LENGTH_OFFSET, 4),
+                 GetNumber(entry + INFO_LENGTH_OFFSET, 4));
+}
+
+size_t Wallet::FirstUnspent() const
+{
+    for (size_t i = 0; i < m_count; ++i)
+    {
+        if ((GetNumber(EntryAt(i) + FLAGS_OFFSET, 4) & FLAG_SPENT) == 0)
+        {
+            return i;
+        }
+    }
+
+    return m_count;
+}
+
+void Wallet::MarkSpent( const size_t i )
+{
+    unsigned char* flags = const_cast<unsigned char*>(EntryAt(i)) + FLAGS_OFFSET;
+    uint32_t value = GetNumber(flags, 4) | FLAG_SPENT;
+    for (size_t j = 4; j > 0; --j)
+    {
+        flags[j - 1] = value & 0xFF;
+        value >>= 8;
+    }
+
+    // msync wants a page aligned address
+    const size_t page = sysconf(_SC_PAGESIZE);
+    unsigned char* start = m_data + ((flags - m_data) / page) * page;
+    if (msync(start, flags + 4 - start, MS_SYNC) != 0)
+    {
+        throw std::runtime_error("Unable to write wallet " + m_filename);
+    }
+}
+
+const unsigned char* Wallet::EntryAt( const size_t i ) const
+{
+    if (i >= m_count)
+    {
+        throw std::out_of_range(m_filename + " holds " + std::to_string(m_count) + " coins, there is no coin " + std::to_string(i));
+    }
+
+    return m_data + HEADER_LENGTH + i * ENTRY_LENGTH;
+}
+
+std::string Wallet::Bytes( const uint64_t offset, const uint64_t length ) const
+{
+    if (offset > m_length || length > m_length - offset)
+    {
+        throw std::runtime_error(m_filename + " is damaged");
+    }
+
+    return std::string(reinterpret_cast<const char*>(m_data) + offset, length);
+}
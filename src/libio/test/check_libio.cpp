@@ -3,21 +3,33 @@
 #include <boost/test/unit_test.hpp>
 
 #include "BlindSignature.h"
+#include "DepositBatch.h"
 #include "MoneyOrder.h"
 #include "MoneyOrderInfo.h"
 #include "Rsa.h"
 #include "SecretSplitting.h"
 #include "Utilities.h"
+#include "Log.h"
+#include "Metrics.h"
+#include "MetricsServer.h"
+#include "NetComm.h"
+#include "PublicKeySet.h"
+#include "Wallet.h"
+#include "WithdrawalBatch.h"
 
 #include <gmpxx.h>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
  
 BOOST_AUTO_TEST_CASE(money_order_test_1)
 {
     MoneyOrder old_mo;
 
-    old_mo.m_amount = 1000;
-    old_mo.m_uniqueness = "the uniqueness string";
+    old_mo.m_uniqueness = CoinId("the coin id 0123");
 
     for (int i = 0; i < 100; ++i)
     {
@@ -55,8 +67,7 @@ BOOST_AUTO_TEST_CASE(money_order_test_1)
     MoneyOrder new_mo;
     new_mo.Deserialize(Utilities::NumberToString(xMpz));
 
-    BOOST_CHECK_EQUAL(new_mo.m_amount, old_mo.m_amount);
-    BOOST_CHECK_EQUAL(new_mo.m_uniqueness, old_mo.m_uniqueness);
+    BOOST_CHECK(new_mo.m_uniqueness == old_mo.m_uniqueness);
     BOOST_REQUIRE_EQUAL(new_mo.m_identity_strings.size(), 200U);
     BOOST_CHECK_EQUAL(new_mo.m_identity_strings[0].first.first, "leftHash_0");
     BOOST_CHECK_EQUAL(new_mo.m_identity_strings[0].first.second, "leftR1_0");
@@ -70,10 +81,37 @@ BOOST_AUTO_TEST_CASE(money_order_test_1)
 }
 
 
+BOOST_AUTO_TEST_CASE(coin_id_test_1)
+{
+    const std::string bytes("\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f\xff", CoinId::LENGTH);
+    CoinId id(bytes);
+    BOOST_CHECK_EQUAL(id.Bytes(), bytes);
+    BOOST_CHECK_EQUAL(id.Hex(), "0102030405060708090a0b0c0d0e0fff");
+
+    CoinId same(bytes);
+    CoinId other(std::string(CoinId::LENGTH, '\x01'));
+    BOOST_CHECK(id == same);
+    BOOST_CHECK(id != other);
+    BOOST_CHECK(other < id);
+    BOOST_CHECK(!(id < same));
+    BOOST_CHECK_EQUAL(CoinId::Hash()(id), CoinId::Hash()(same));
+    BOOST_CHECK(CoinId() < other);
+
+    BOOST_CHECK_THROW(CoinId("too short"), std::invalid_argument);
+
+    // a money order carries its id in binary
+    MoneyOrder mo;
+    mo.m_uniqueness = id;
+    MoneyOrder new_mo;
+    new_mo.Deserialize(mo.Serialize());
+    BOOST_CHECK(new_mo.m_uniqueness == id);
+}
+
 BOOST_AUTO_TEST_CASE(money_order_info_test_1)
 {
     std::vector<MoneyOrderInfo> info_vec;
     MoneyOrderInfo info;
+    info.m_amount = 50;
     info.m_blinding_factor = "2394262445592642632306707632461079788577338370913227907193177833182985877544234442800057994459481910350241788357623265528469560138808620624954012423617897";
 
     mpz_class left;
@@ -95,6 +133,7 @@ BOOST_AUTO_TEST_CASE(money_order_info_test_1)
     MoneyOrderInfo new_info;
     new_info.Deserialize(ser);
 
+    BOOST_CHECK_EQUAL(info.m_amount, new_info.m_amount);
     BOOST_CHECK_EQUAL(info.m_blinding_factor, new_info.m_blinding_factor);
     BOOST_CHECK(info.m_commit_data[0].first.b == new_info.m_commit_data[0].first.b);
     BOOST_CHECK(info.m_commit_data[0].second.b == new_info.m_commit_data[0].second.b);
@@ -102,3 +141,461 @@ BOOST_AUTO_TEST_CASE(money_order_info_test_1)
     BOOST_CHECK(info.m_commit_data[1].second.b == new_info.m_commit_data[1].second.b);
 }
 
+BOOST_AUTO_TEST_CASE(deposit_batch_test_1)
+{
+    DepositBatch batch;
+    batch.m_depositor = "merchant";
+
+    Deposit deposit;
+    deposit.m_coin.m_money_order = "123456789";
+    deposit.m_coin.m_signature   = "42";
+    deposit.m_coin.m_amount      = 20;
+    deposit.m_selector           = "1221";
+    deposit.m_sequence           = 7;
+    deposit.m_commit_data.push_back("first");
+    deposit.m_commit_data.push_back("second");
+    batch.m_deposits.push_back(deposit);
+
+    deposit.m_coin.m_money_order = "987654321";
+    batch.m_deposits.push_back(deposit);
+
+    DepositBatch new_batch;
+    new_batch.Deserialize(batch.Serialize());
+
+    BOOST_CHECK_EQUAL(new_batch.m_depositor, "merchant");
+    BOOST_REQUIRE_EQUAL(new_batch.m_deposits.size(), 2U);
+    BOOST_CHECK_EQUAL(new_batch.m_deposits[0].m_coin.m_money_order, "123456789");
+    BOOST_CHECK_EQUAL(new_batch.m_deposits[1].m_coin.m_money_order, "987654321");
+    BOOST_CHECK_EQUAL(new_batch.m_deposits[1].m_coin.m_signature, "42");
+    BOOST_CHECK_EQUAL(new_batch.m_deposits[1].m_coin.m_amount, 20U);
+    BOOST_CHECK_EQUAL(new_batch.m_deposits[1].m_selector, "1221");
+    BOOST_CHECK_EQUAL(new_batch.m_deposits[1].m_sequence, 7U);
+    BOOST_REQUIRE_EQUAL(new_batch.m_deposits[1].m_commit_data.size(), 2U);
+    BOOST_CHECK_EQUAL(new_batch.m_deposits[1].m_commit_data[1], "second");
+
+    // assignment must not leave the copy serializing the original
+    Deposit assigned;
+    assigned = deposit;
+    deposit.m_selector = "2112";
+    Deposit new_deposit;
+    new_deposit.Deserialize(assigned.Serialize());
+    BOOST_CHECK_EQUAL(new_deposit.m_selector, "1221");
+}
+
+BOOST_AUTO_TEST_CASE(public_key_set_test_1)
+{
+    PublicKeySet keys;
+    keys.m_epoch = 7;
+    keys.m_keys[PublicKeySet::KeyId(7, 5)]  = std::make_pair("3233", "17");
+    keys.m_keys[PublicKeySet::KeyId(7, 20)] = std::make_pair("4087", "65537");
+    keys.m_keys[PublicKeySet::KeyId(6, 5)]  = std::make_pair("2773", "3");
+
+    PublicKeySet new_keys;
+    new_keys.Deserialize(keys.Serialize());
+
+    BOOST_CHECK_EQUAL(new_keys.m_epoch, 7U);
+    BOOST_REQUIRE_EQUAL(new_keys.m_keys.size(), 3U);
+    BOOST_CHECK_EQUAL(new_keys.m_keys[PublicKeySet::KeyId(7, 5)].first, "3233");
+    BOOST_CHECK_EQUAL(new_keys.m_keys[PublicKeySet::KeyId(7, 20)].second, "65537");
+    BOOST_CHECK_EQUAL(new_keys.m_keys[PublicKeySet::KeyId(6, 5)].first, "2773");
+    BOOST_CHECK(new_keys.m_keys.find(PublicKeySet::KeyId(6, 20)) == new_keys.m_keys.end());
+}
+
+BOOST_AUTO_TEST_CASE(public_key_set_test_fingerprint)
+{
+    PublicKeySet keys;
+    keys.m_epoch = 7;
+    keys.m_keys[PublicKeySet::KeyId(7, 5)] = std::make_pair("3233", "17");
+    const std::string serialized = keys.Serialize();
+
+    // the same bytes always get the same fingerprint, 16 bytes of hex
+    BOOST_CHECK_EQUAL(PublicKeySet::Fingerprint(serialized).size(), 32U);
+    BOOST_CHECK_EQUAL(PublicKeySet::Fingerprint(serialized), PublicKeySet::Fingerprint(std::string(serialized)));
+
+    // and a rotation changes it
+    keys.m_epoch = 8;
+    keys.m_keys[PublicKeySet::KeyId(8, 5)] = std::make_pair("4087", "65537");
+    BOOST_CHECK(PublicKeySet::Fingerprint(serialized) != PublicKeySet::Fingerprint(keys.Serialize()));
+}
+
+BOOST_AUTO_TEST_CASE(withdrawal_batch_test_1)
+{
+    BlindedMoneyOrders blinded;
+    blinded.m_money_orders.push_back("3233");
+    blinded.m_money_orders.push_back("4087");
+
+    BlindedMoneyOrders new_blinded;
+    new_blinded.Deserialize(blinded.Serialize());
+    BOOST_REQUIRE_EQUAL(new_blinded.m_money_orders.size(), 2U);
+    BOOST_CHECK_EQUAL(new_blinded.m_money_orders[1], "4087");
+
+    OpenedMoneyOrders opened;
+    opened.m_info.push_back("info");
+    opened.m_money_orders.push_back(std::string("order\0with a zero", 17));
+
+    OpenedMoneyOrders new_opened;
+    new_opened.Deserialize(opened.Serialize());
+    BOOST_REQUIRE_EQUAL(new_opened.m_money_orders.size(), 1U);
+    BOOST_CHECK_EQUAL(new_opened.m_info[0], "info");
+    BOOST_CHECK_EQUAL(new_opened.m_money_orders[0], opened.m_money_orders[0]);
+
+    // a refusal is an empty list of signatures
+    SignedMoneyOrders signatures;
+    SignedMoneyOrders new_signatures;
+    new_signatures.m_signatures.push_back("stale");
+    new_signatures.Deserialize(signatures.Serialize());
+    BOOST_CHECK(new_signatures.m_signatures.empty());
+}
+
+BOOST_AUTO_TEST_CASE(wallet_test_1)
+{
+    const std::string filename = "/tmp/check_libio_wallet.bin";
+
+    std::vector<Wallet::Entry> entries(3);
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        entries[i].id     = CoinId(std::string(CoinId::LENGTH, static_cast<char>('a' + i)));
+        entries[i].amount = 10 * (i + 1);
+        entries[i].coin   = std::string("coin\0", 5) + std::to_string(i);
+        entries[i].info   = "info" + std::to_string(i);
+    }
+    entries[1].info.clear();
+
+    Wallet::Create(filename, entries);
+
+    {
+        Wallet wallet(filename);
+        BOOST_REQUIRE_EQUAL(wallet.Size(), 3U);
+        BOOST_CHECK(wallet.Index(2).id == entries[2].id);
+        BOOST_CHECK_EQUAL(wallet.Index(2).amount, 30U);
+        BOOST_CHECK(!wallet.Index(2).spent);
+        BOOST_CHECK_EQUAL(wallet.CoinData(0), entries[0].coin);
+        BOOST_CHECK_EQUAL(wallet.InfoData(0), "info0");
+        BOOST_CHECK_EQUAL(wallet.CoinData(1), entries[1].coin);
+        BOOST_CHECK_EQUAL(wallet.InfoData(1), "");
+        BOOST_CHECK_EQUAL(wallet.InfoData(2), "info2");
+        BOOST_CHECK_THROW(wallet.CoinData(3), std::out_of_range);
+
+        BOOST_CHECK_EQUAL(wallet.FirstUnspent(), 0U);
+        wallet.MarkSpent(0);
+        BOOST_CHECK(wallet.Index(0).spent);
+        BOOST_CHECK_EQUAL(wallet.FirstUnspent(), 1U);
+    }
+
+    // spent flags are kept in the file
+    {
+        Wallet wallet(filename);
+        BOOST_CHECK(wallet.Index(0).spent);
+        wallet.MarkSpent(1);
+        wallet.MarkSpent(2);
+        BOOST_CHECK_EQUAL(wallet.FirstUnspent(), wallet.Size());
+        BOOST_CHECK_EQUAL(wallet.CoinData(2), entries[2].coin);
+    }
+
+    // more coins go after the ones already there, which keep their spent flags
+    Wallet::Create(filename, std::vector<Wallet::Entry>(entries.begin(), entries.begin() + 2));
+    Wallet(filename).MarkSpent(0);
+    Wallet::Append(filename, std::vector<Wallet::Entry>(entries.begin() + 2, entries.end()));
+    {
+        Wallet wallet(filename);
+        BOOST_REQUIRE_EQUAL(wallet.Size(), 3U);
+        BOOST_CHECK(wallet.Index(0).spent);
+        BOOST_CHECK_EQUAL(wallet.FirstUnspent(), 1U);
+        BOOST_CHECK_EQUAL(wallet.CoinData(1), entries[1].coin);
+        BOOST_CHECK(wallet.Index(2).id == entries[2].id);
+        BOOST_CHECK_EQUAL(wallet.InfoData(2), "info2");
+    }
+
+    // an empty wallet, and a file that is not a wallet
+    Wallet::Create(filename, std::vector<Wallet::Entry>());
+    BOOST_CHECK_EQUAL(Wallet(filename).Size(), 0U);
+
+    FILE* f = fopen(filename.c_str(), "wb");
+    fputs("not a wallet at all", f);
+    fclose(f);
+    BOOST_CHECK_THROW(Wallet wallet(filename), std::runtime_error);
+    BOOST_CHECK_THROW(Wallet::Append(filename, entries), std::runtime_error);
+
+    std::remove(filename.c_str());
+    BOOST_CHECK_THROW(Wallet wallet(filename), std::runtime_error);
+
+    // appending to no wallet at all makes one
+    Wallet::Append(filename, entries);
+    BOOST_CHECK_EQUAL(Wallet(filename).Size(), 3U);
+    std::remove(filename.c_str());
+}
+
+namespace
+{
+    class EchoServer : public NetComm::Server
+    {
+        public:
+            EchoServer( unsigned short port ) : Server( port ) {}
+            void run(tcp::socket sock1)
+            {
+                std::string str = ReadFramedAndAcknowledge(sock1);
+                WriteFramedAndWaitForAcknowledge(sock1, str);
+                WriteAndWaitForAcknowledge(sock1, "done");
+            }
+    };
+}
+
+namespace
+{
+    class ClosingServer : public NetComm::Server
+    {
+        public:
+            ClosingServer( unsigned short port ) : Server( port ) {}
+            void run(tcp::socket sock1)
+            {
+                // ends every connection as soon as it is made
+            }
+    };
+}
+
+BOOST_AUTO_TEST_CASE(client_idle_test_1)
+{
+    EchoServer* server = new EchoServer(19324);
+    std::thread serverThread(&EchoServer::Start, server);
+    serverThread.detach();
+
+    ClosingServer* closingServer = new ClosingServer(19325);
+    std::thread closingThread(&ClosingServer::Start, closingServer);
+    closingThread.detach();
+
+    NetComm::Client open("127.0.0.1", "19324");
+    open.Connect();
+
+    NetComm::Client closed("127.0.0.1", "19325");
+    closed.Connect();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    BOOST_CHECK(open.Idle());
+    BOOST_CHECK(!closed.Idle());
+
+    // still usable after the check
+    open.WriteFramedAndWaitForAcknowledge("ping");
+    BOOST_CHECK_EQUAL(open.ReadFramedAndAcknowledge(), "ping");
+    BOOST_CHECK_EQUAL(open.ReadAndAcknowledge(), "done");
+}
+
+BOOST_AUTO_TEST_CASE(framed_message_test_1)
+{
+    // the server keeps accepting until the test program exits
+    EchoServer* server = new EchoServer(19321);
+    std::thread serverThread(&EchoServer::Start, server);
+    serverThread.detach();
+
+    NetComm::Client client("127.0.0.1", "19321");
+    client.Connect();
+
+    // much larger than a single read, and full of embedded zeros
+    std::string message(1 << 20, '\0');
+    for (size_t i = 0; i < message.size(); i += 7)
+    {
+        message[i] = static_cast<char>(i);
+    }
+
+    client.WriteFramedAndWaitForAcknowledge(message);
+    BOOST_CHECK(client.ReadFramedAndAcknowledge() == message);
+
+    // unframed messages still work after a framed one
+    BOOST_CHECK_EQUAL(client.ReadAndAcknowledge(), "done");
+}
+
+BOOST_AUTO_TEST_CASE(framed_message_test_2)
+{
+    EchoServer* server = new EchoServer(19323);
+    std::thread serverThread(&EchoServer::Start, server);
+    serverThread.detach();
+
+    NetComm::Client client("127.0.0.1", "19323");
+    client.Connect();
+
+    Rsa::KeyPair key_pair = Rsa::GenerateKeyPair(256);
+    mpz_class plain_text = Utilities::StringToNumber(std::string(64 * 1024, 'x'));
+    mpz_class signed_text = Rsa::Sign(plain_text, key_pair, true);
+
+    // unsign the blocks as they come back from the server
+    Rsa::BlockStream stream(key_pair.pub, true);
+    size_t pieces = 0;
+    client.WriteFramedAndWaitForAcknowledge(Rsa::BlockDigits(signed_text, key_pair.pub));
+    client.ReadFramedAndAcknowledge([&](const char* digits, size_t length)
+    {
+        stream.Feed(digits, length);
+        ++pieces;
+    });
+
+    BOOST_CHECK(pieces > 1);
+    BOOST_CHECK(stream.Finish() == plain_text);
+    BOOST_CHECK_EQUAL(client.ReadAndAcknowledge(), "done");
+}
+
+BOOST_AUTO_TEST_CASE(metrics_counter_test_1)
+{
+    Metrics::Counter& counter = Metrics::GetCounter("test_events_total{kind=\"a\"}", "Events");
+
+    // every thread lands in its own shard, the value adds them up
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.push_back(std::thread([&counter]
+        {
+            for (int i = 0; i < 10000; ++i)
+            {
+                counter.Increment();
+            }
+        }));
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    BOOST_CHECK_EQUAL(counter.Value(), 40000U);
+
+    // the same name is the same counter, another label set is another one
+    BOOST_CHECK_EQUAL(&Metrics::GetCounter("test_events_total{kind=\"a\"}", "Events"), &counter);
+    BOOST_CHECK_EQUAL(Metrics::GetCounter("test_events_total{kind=\"b\"}", "Events").Value(), 0U);
+
+    BOOST_CHECK_THROW(Metrics::GetHistogram("test_events_total", "Events"), std::logic_error);
+}
+
+BOOST_AUTO_TEST_CASE(metrics_histogram_test_1)
+{
+    // buckets cover every value once, in order
+    for (unsigned int i = 0; i + 1 < Metrics::Histogram::NUM_BUCKETS; ++i)
+    {
+        BOOST_REQUIRE_EQUAL(Metrics::Histogram::BucketUpperBound(i) + 1, Metrics::Histogram::BucketLowerBound(i + 1));
+        BOOST_REQUIRE_EQUAL(Metrics::Histogram::BucketIndex(Metrics::Histogram::BucketLowerBound(i)), i);
+        BOOST_REQUIRE_EQUAL(Metrics::Histogram::BucketIndex(Metrics::Histogram::BucketUpperBound(i)), i);
+    }
+    BOOST_CHECK_EQUAL(Metrics::Histogram::BucketIndex(~0ULL), Metrics::Histogram::NUM_BUCKETS - 1);
+
+    // 1us to 10ms
+    Metrics::Histogram& histogram = Metrics::GetHistogram("test_latency_seconds", "Latency");
+    for (uint64_t us = 1; us <= 10000; ++us)
+    {
+        histogram.Record(us * 1000);
+    }
+
+    Metrics::HistogramSnapshot snapshot = histogram.Snapshot();
+    BOOST_CHECK_EQUAL(snapshot.count, 10000U);
+    BOOST_CHECK_EQUAL(snapshot.sum, 10000ULL * 10001 / 2 * 1000);
+
+    // within a sub bucket of the exact answer
+    const double error = 1.0 / Metrics::Histogram::SUB_BUCKETS;
+    BOOST_CHECK_CLOSE(static_cast<double>(snapshot.Percentile(0.50)), 5000e3, 100 * error);
+    BOOST_CHECK_CLOSE(static_cast<double>(snapshot.Percentile(0.99)), 9900e3, 100 * error);
+    BOOST_CHECK_CLOSE(static_cast<double>(snapshot.Percentile(1.00)), 10000e3, 100 * error);
+}
+
+BOOST_AUTO_TEST_CASE(metrics_exposition_test_1)
+{
+    Metrics::GetCounter("test_exposed_total", "Exposed events").Increment(3);
+    Metrics::GetHistogram("test_exposed_seconds{op=\"x\"}", "Exposed latency").Record(1500);
+
+    std::string text = Metrics::Exposition();
+    BOOST_CHECK(text.find("# TYPE koolkash_test_exposed_total counter\n") != std::string::npos);
+    BOOST_CHECK(text.find("koolkash_test_exposed_total 3\n") != std::string::npos);
+    BOOST_CHECK(text.find("# TYPE koolkash_test_exposed_seconds histogram\n") != std::string::npos);
+    // le is inclusive: 1500ns is counted from the 4095ns bound on, not at 1023ns
+    BOOST_CHECK(text.find("koolkash_test_exposed_seconds_bucket{op=\"x\",le=\"1.023e-06\"} 0\n") != std::string::npos);
+    BOOST_CHECK(text.find("koolkash_test_exposed_seconds_bucket{op=\"x\",le=\"4.095e-06\"} 1\n") != std::string::npos);
+    BOOST_CHECK(text.find("koolkash_test_exposed_seconds_bucket{op=\"x\",le=\"+Inf\"} 1\n") != std::string::npos);
+    BOOST_CHECK(text.find("koolkash_test_exposed_seconds_count{op=\"x\"} 1\n") != std::string::npos);
+
+    // served over HTTP as well
+    Metrics::StartMetricsServer(19322);
+
+    boost::asio::io_service io_service;
+    tcp::socket sock(io_service);
+    tcp::resolver resolver(io_service);
+    boost::asio::connect(sock, resolver.resolve({ "127.0.0.1", "19322" }));
+
+    std::string request = "GET /metrics HTTP/1.0\r\n\r\n";
+    boost::asio::write(sock, boost::asio::buffer(request));
+
+    boost::system::error_code error;
+    boost::asio::streambuf response;
+    boost::asio::read(sock, response, error);
+    BOOST_CHECK(error == boost::asio::error::eof);
+
+    std::string answer((std::istreambuf_iterator<char>(&response)), std::istreambuf_iterator<char>());
+    BOOST_CHECK_EQUAL(answer.compare(0, 15, "HTTP/1.0 200 OK"), 0);
+    BOOST_CHECK(answer.find("koolkash_test_exposed_total 3\n") != std::string::npos);
+}
+
+namespace
+{
+    std::string ReadBack(FILE* file)
+    {
+        std::string contents;
+        std::rewind(file);
+
+        char buffer[4096];
+        size_t n;
+        while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+        {
+            contents.append(buffer, n);
+        }
+
+        return contents;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(log_test_1)
+{
+    FILE* info     = std::tmpfile();
+    FILE* warnings = std::tmpfile();
+    Log::SetStreams(info, warnings);
+
+    Log::Info("account opened").Field("identity", "alice").Field("amount", 100);
+    Log::Debug("not shown").Field("identity", "alice");
+    Log::Warning("double deposit").Field("identities", "bob,eve").Field("note", "two \"words\"\n");
+
+    // records from many threads all arrive
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.push_back(std::thread([t]
+        {
+            for (int i = 0; i < 100; ++i)
+            {
+                Log::Info("tick").Field("thread", t).Field("i", i);
+            }
+        }));
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    Log::Flush();
+    Log::SetStreams(stdout, stderr);
+
+    std::string infoLines    = ReadBack(info);
+    std::string warningLines = ReadBack(warnings);
+    std::fclose(info);
+    std::fclose(warnings);
+
+    // 2015-04-01T12:00:00.123Z INFO account opened identity=alice amount=100
+    size_t line = infoLines.find(" INFO account opened identity=alice amount=100\n");
+    BOOST_REQUIRE(line != std::string::npos);
+    BOOST_CHECK_EQUAL(line, 24U);
+    BOOST_CHECK_EQUAL(infoLines[10], 'T');
+    BOOST_CHECK_EQUAL(infoLines[23], 'Z');
+
+    BOOST_CHECK(infoLines.find("not shown") == std::string::npos);
+
+    size_t ticks = 0;
+    for (size_t pos = 0; (pos = infoLines.find(" INFO tick ", pos)) != std::string::npos; ++pos)
+    {
+        ++ticks;
+    }
+    BOOST_CHECK_EQUAL(ticks, 400U);
+    BOOST_CHECK(infoLines.find("tick thread=3 i=99\n") != std::string::npos);
+
+    // values that are not a single token are quoted
+    BOOST_CHECK(warningLines.find(" WARNING double deposit identities=bob,eve note=\"two \\\"words\\\"\\x0a\"\n") != std::string::npos);
+}
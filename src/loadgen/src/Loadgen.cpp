@@ -0,0 +1,326 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "BankServer.h"
+#include "BuyerClient.h"
+#include "Log.h"
+#include "Metrics.h"
+#include "MerchantServer.h"
+
+namespace
+{
+    const char* USAGE = "Usage: koolkash_loadgen [--buyers <n>] [--merchants <n>] [--rounds <n>]"
+                        " [--cheat-fraction <f>] [--amount <n>] [--port <n>]"
+                        " [--money-orders <n>] [--ident-strings <n>] [--audit-probability <p>]"
+                        " [--verbose] [--dump-metrics]\n";
+
+    const std::string HOST = "127.0.0.1";
+
+    struct Options
+    {
+        unsigned int buyers        = 4;
+        unsigned int merchants     = 1;
+        // withdrawals and purchases each buyer makes
+        unsigned int rounds        = 1;
+        // this share of the buyers spends every money order twice
+        double       cheatFraction = 0;
+        unsigned int amount        = 10;
+        // the bank listens here, the merchants on the ports after it
+        unsigned int port          = 19500;
+        bool         verbose       = false;
+        // print the servers' metrics after the results
+        bool         dumpMetrics   = false;
+
+        Bank::BankServer::Options bank;
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    //! Latencies of one step of the protocol, recorded by every buyer thread
+    /////////////////////////////////////////////////////////////////////////////////////
+    class Phase
+    {
+        public:
+            explicit Phase( const std::string& name ) : name( name ) {}
+
+            // runs step, timing it, and returns whether it succeeded
+            bool Time( const std::function<bool()>& step )
+            {
+                auto start = std::chrono::steady_clock::now();
+                bool succeeded = step();
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (succeeded)
+                {
+                    m_latencies.push_back(elapsed.count());
+                }
+                else
+                {
+                    ++m_failures;
+                }
+
+                return succeeded;
+            }
+
+            void Report( const double wallSeconds )
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                std::sort(m_latencies.begin(), m_latencies.end());
+
+                std::printf("%-16s %8zu %8zu %10.2f %10.1f %10.1f %10.1f\n",
+                            name.c_str(), m_latencies.size(), m_failures,
+                            m_latencies.size() / wallSeconds,
+                            Percentile(0.50) * 1000, Percentile(0.99) * 1000, Percentile(0.999) * 1000);
+            }
+
+        private:
+            // nearest rank on the sorted latencies
+            double Percentile( const double p ) const
+            {
+                if (m_latencies.empty())
+                {
+                    return 0;
+                }
+
+                size_t rank = static_cast<size_t>(std::ceil(p * m_latencies.size()));
+                return m_latencies[std::max<size_t>(rank, 1) - 1];
+            }
+
+            std::string         name;
+            std::mutex          m_mutex;
+            std::vector<double> m_latencies;
+            size_t              m_failures = 0;
+    };
+
+    bool ParseOptions(int argc, char* argv[], Options& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string option = argv[i];
+            bool hasValue = (i + 1 < argc);
+
+            if (option == "--buyers" && hasValue && std::atoi(argv[i + 1]) > 0)
+            {
+                options.buyers = std::atoi(argv[++i]);
+            }
+            else if (option == "--merchants" && hasValue && std::atoi(argv[i + 1]) > 0)
+            {
+                options.merchants = std::atoi(argv[++i]);
+            }
+            else if (option == "--rounds" && hasValue && std::atoi(argv[i + 1]) > 0)
+            {
+                options.rounds = std::atoi(argv[++i]);
+            }
+            else if (option == "--cheat-fraction" && hasValue &&
+                     std::atof(argv[i + 1]) >= 0 && std::atof(argv[i + 1]) <= 1)
+            {
+                options.cheatFraction = std::atof(argv[++i]);
+            }
+            else if (option == "--amount" && hasValue && std::atoi(argv[i + 1]) > 0)
+            {
+                options.amount = std::atoi(argv[++i]);
+            }
+            else if (option == "--port" && hasValue && std::atoi(argv[i + 1]) > 0)
+            {
+                options.port = std::atoi(argv[++i]);
+            }
+            else if (option == "--money-orders" && hasValue && std::atoi(argv[i + 1]) >= 2)
+            {
+                options.bank.numMoneyOrders = std::atoi(argv[++i]);
+            }
+            else if (option == "--ident-strings" && hasValue && std::atoi(argv[i + 1]) >= 1)
+            {
+                options.bank.numIdentStrings = std::atoi(argv[++i]);
+            }
+            else if (option == "--audit-probability" && hasValue &&
+                     std::atof(argv[i + 1]) >= 0 && std::atof(argv[i + 1]) < 1)
+            {
+                options.bank.auditProbability = std::atof(argv[++i]);
+            }
+            else if (option == "--verbose")
+            {
+                options.verbose = true;
+            }
+            else if (option == "--dump-metrics")
+            {
+                options.dumpMetrics = true;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void StartInBackground(NetComm::Server* server)
+    {
+        std::thread(&NetComm::Server::Start, server).detach();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        std::cerr << USAGE;
+        return 1;
+    }
+
+    // coins, merchant spools and the like go to a scratch directory
+    char workDirectory[] = "/tmp/koolkash_loadgen.XXXXXX";
+    if (mkdtemp(workDirectory) == NULL || chdir(workDirectory) != 0)
+    {
+        std::cerr << "Unable to create a work directory\n";
+        return 1;
+    }
+
+    // the servers log, and the buyers report on std::cout, which would drown the
+    // results; warnings and errors still go to stderr
+    std::ofstream devNull("/dev/null");
+    std::streambuf* stdoutBuffer = std::cout.rdbuf();
+    if (!options.verbose)
+    {
+        std::cout.rdbuf(devNull.rdbuf());
+        Log::SetStreams(std::fopen("/dev/null", "w"), stderr);
+    }
+
+    // the servers hold on to these for as long as they run
+    std::string bankPort = std::to_string(options.port);
+    std::vector<std::string> merchantPorts;
+    std::vector<std::string> merchantIdentities;
+    for (unsigned int i = 0; i < options.merchants; ++i)
+    {
+        merchantPorts.push_back(std::to_string(options.port + 1 + i));
+        merchantIdentities.push_back("merchant" + std::to_string(i));
+    }
+
+    try
+    {
+        // the servers run until the process exits
+        StartInBackground(new Bank::BankServer(&bankPort[0], options.bank));
+        for (unsigned int i = 0; i < options.merchants; ++i)
+        {
+            StartInBackground(new Merchant::MerchantServer(merchantPorts[i].c_str(),
+                                                           HOST.c_str(),
+                                                           bankPort.c_str(),
+                                                           merchantIdentities[i].c_str(),
+                                                           false));
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cout.rdbuf(stdoutBuffer);
+        std::cerr << "Exception starting the servers: " << e.what() << "\n";
+        return 1;
+    }
+
+    Phase openAccount("open_account");
+    Phase withdrawal("gen_money_order");
+    Phase purchase("buy_item");
+    Phase doubleSpend("buy_item (again)");
+
+    const unsigned int numCheats = static_cast<unsigned int>(options.cheatFraction * options.buyers + 0.5);
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> buyers;
+    for (unsigned int b = 0; b < options.buyers; ++b)
+    {
+        buyers.push_back(std::thread([&, b]
+        {
+            const std::string identity = "buyer" + std::to_string(b);
+            const char* merchantPort   = merchantPorts[b % options.merchants].c_str();
+            const bool  cheat          = (b < numCheats);
+
+            if (!openAccount.Time([&]{ return Buyer::OpenAccount(HOST.c_str(), bankPort.c_str(), identity, 1000); }))
+            {
+                return;
+            }
+
+            for (unsigned int r = 0; r < options.rounds; ++r)
+            {
+                const std::string coin = identity + "_" + std::to_string(r);
+
+                if (!withdrawal.Time([&]{ return Buyer::GenerateMoneyOrder(HOST.c_str(), bankPort.c_str(), identity, options.amount, coin); }))
+                {
+                    continue;
+                }
+
+                purchase.Time([&]{ return Buyer::BuyItem(HOST.c_str(), merchantPort, coin); });
+
+                if (cheat)
+                {
+                    doubleSpend.Time([&]{ return Buyer::BuyItem(HOST.c_str(), merchantPort, coin, 0); });
+                }
+            }
+        }));
+    }
+
+    for (auto& buyer : buyers)
+    {
+        buyer.join();
+    }
+
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+
+    std::cout.rdbuf(stdoutBuffer);
+
+    std::printf("%u buyers (%u cheating), %u merchants, %u rounds in %.2fs, work files in %s\n",
+                options.buyers, numCheats, options.merchants, options.rounds, wall.count(), workDirectory);
+    std::printf("%-16s %8s %8s %10s %10s %10s %10s\n",
+                "phase", "ok", "failed", "per sec", "p50 ms", "p99 ms", "p999 ms");
+    openAccount.Report(wall.count());
+    withdrawal.Report(wall.count());
+    purchase.Report(wall.count());
+    if (numCheats > 0)
+    {
+        doubleSpend.Report(wall.count());
+    }
+
+    if (options.dumpMetrics)
+    {
+        std::printf("\n%s", Metrics::Exposition().c_str());
+    }
+
+    // the servers never return from Start(), so leave without running destructors
+    Log::Flush();
+    std::fflush(stdout);
+    std::_Exit(0);
+}
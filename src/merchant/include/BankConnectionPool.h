@@ -0,0 +1,85 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#ifndef BANKCONNECTIONPOOL_H
+#define BANKCONNECTIONPOOL_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "NetComm.h"
+
+namespace Merchant
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+    //! Keeps a set of warm connections to the bank so that a sale does not have to
+    //! pay for a TCP handshake.  Connections are handed out as leases; a lease goes
+    //! back to the pool only when the caller marks the conversation as finished.
+    //! Connections the bank closed meanwhile are dropped when they would be handed
+    //! out, and new ones opened in their place.
+    /////////////////////////////////////////////////////////////////////////////////////
+    class BankConnectionPool
+    {
+        public:
+            class Connection
+            {
+                public:
+                    Connection( BankConnectionPool& pool, std::unique_ptr<::NetComm::Client> client );
+                    Connection( Connection&& other );
+                    ~Connection();
+
+                    ::NetComm::Client* operator->() { return client.get(); }
+
+                    // hand the connection back to the pool, it is in a known state
+                    void Release();
+
+                private:
+                    Connection( const Connection& ) = delete;
+                    Connection& operator=( const Connection& ) = delete;
+
+                    BankConnectionPool*                pool;
+                    std::unique_ptr<::NetComm::Client> client;
+            };
+
+            BankConnectionPool( const char* bankHost,
+                                const char* bankPort,
+                                const unsigned int size );
+            ~BankConnectionPool();
+
+            Connection Acquire();
+
+        private:
+            std::unique_ptr<::NetComm::Client> Open();
+            void Close( std::unique_ptr<::NetComm::Client> client );
+            void Return( std::unique_ptr<::NetComm::Client> client );
+
+            const char*  bankHost;
+            const char*  bankPort;
+            unsigned int size;
+
+            std::mutex m_mutex;
+            std::vector<std::unique_ptr<::NetComm::Client>> m_idle;
+    };
+}
+
+#endif // BANKCONNECTIONPOOL_H
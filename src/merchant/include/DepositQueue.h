@@ -0,0 +1,88 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#ifndef DEPOSITQUEUE_H
+#define DEPOSITQUEUE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BankConnectionPool.h"
+#include "DepositBatch.h"
+
+namespace Merchant
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+    //! Accepts verified money orders and forwards them to the bank in the background
+    //! with DEPOSIT BATCH.  Each deposit is written to the spool directory before
+    //! Enqueue() returns and removed once the bank has answered for it, so deposits
+    //! that were queued when the merchant stopped are sent after it restarts.  Each
+    //! deposit gets a number no earlier deposit had, across restarts, which lets the
+    //! bank know a batch sent again.
+    /////////////////////////////////////////////////////////////////////////////////////
+    class DepositQueue
+    {
+        public:
+            DepositQueue( BankConnectionPool& bankPool,
+                          const std::string&  identity,
+                          const std::string&  spoolDirectory );
+            ~DepositQueue();
+
+            void Enqueue( const Deposit& deposit );
+
+        private:
+            static const unsigned int MAX_BATCH_SIZE = 64;
+
+            struct Entry
+            {
+                Entry( const std::string& f, const Deposit& d ) : spoolFile(f), deposit(d) {}
+
+                std::string spoolFile;
+                Deposit     deposit;
+            };
+
+            void LoadSpool();
+            void Worker();
+            bool Forward( const std::vector<Entry>& entries );
+
+            BankConnectionPool& bankPool;
+            std::string         identity;
+            std::string         spoolDirectory;
+
+            std::mutex              m_mutex;
+            std::condition_variable m_cond;
+            std::deque<Entry>       m_pending;
+            unsigned long long      m_next_sequence     = 1;
+            // numbers below this one are saved as used in the spool directory
+            unsigned long long      m_reserved_sequence = 1;
+            bool                    m_stopping          = false;
+
+            std::thread m_worker;
+    };
+}
+
+#endif // DEPOSITQUEUE_H
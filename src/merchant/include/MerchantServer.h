@@ -24,8 +24,15 @@
 #ifndef MERCHANTSERVER_H
 #define MERCHANTSERVER_H
 
+#include <chrono>
 #include <cstdlib>
+#include <map>
+#include <mutex>
+#include "BankConnectionPool.h"
+#include "DepositQueue.h"
 #include "NetComm.h"
+#include "PublicKeySet.h"
+#include "Rsa.h"
 
 namespace Merchant
 {
@@ -41,16 +48,47 @@ namespace Merchant
                   bankHost( bankHost ),
                   bankPort( bankPort ),
                   identity( identity ),
-                  cheat( cheat )
-                  {}
+                  cheat( cheat ),
+                  m_bank_pool( bankHost, bankPort, BANK_POOL_SIZE ),
+                  m_deposit_queue( m_bank_pool, identity, std::string(identity) + ".spool" )
+            {
+                OpenAccount();
+                RefreshBankKey();
+            }
             ~MerchantServer() = default;
             void run(tcp::socket sock1);
 
         private:
+            static const unsigned int BANK_POOL_SIZE = 4;
+
+            void OpenAccount();
+
+            // the bank's keys are cached between sales.  The bank's key id is checked
+            // once they get old, or when a money order will not verify against them,
+            // and they are fetched again only if it changed.  Returns false if the
+            // bank has no key for the denomination in that epoch.
+            bool BankKey( const unsigned int epoch, const unsigned int amount, Rsa::PublicKey& pub );
+            void CheckBankKey();
+            // CheckBankKey() for a money order the cached keys cannot check, at most
+            // once per BANK_KEY_MIN_RECHECK however many such money orders come in
+            void RecheckBankKey();
+            void RefreshBankKey();
+
             const char* bankHost;
             const char* bankPort;
             std::string identity;
             bool  cheat;
+
+            BankConnectionPool m_bank_pool;
+            DepositQueue       m_deposit_queue;
+
+            std::mutex                                    m_bank_key_mutex;
+            // maps  epoch and denomination to  the bank's key for them
+            std::map<PublicKeySet::KeyId, Rsa::PublicKey> m_bank_keys;
+            // the fingerprint of the key set m_bank_keys came from
+            std::string                                   m_bank_key_id;
+            std::chrono::steady_clock::time_point         m_bank_key_time;
+            std::chrono::steady_clock::time_point         m_bank_key_recheck_time;
     };
 }
 
@@ -0,0 +1,135 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#include "BankConnectionPool.h"
+#include "Log.h"
+
+#include <utility>
+
+Merchant::BankConnectionPool::Connection::Connection( BankConnectionPool& pool,
+                                                      std::unique_ptr<::NetComm::Client> client )
+    : pool( &pool ),
+      client( std::move(client) )
+{
+}
+
+Merchant::BankConnectionPool::Connection::Connection( Connection&& other )
+    : pool( other.pool ),
+      client( std::move(other.client) )
+{
+}
+
+Merchant::BankConnectionPool::Connection::~Connection()
+{
+    // a lease that was never released may be half way through a command,
+    // so the socket is dropped rather than handed to the next sale
+}
+
+void Merchant::BankConnectionPool::Connection::Release()
+{
+    if (client)
+    {
+        pool->Return( std::move(client) );
+    }
+}
+
+Merchant::BankConnectionPool::BankConnectionPool( const char* bankHost,
+                                                  const char* bankPort,
+                                                  const unsigned int size )
+    : bankHost( bankHost ),
+      bankPort( bankPort ),
+      size( size )
+{
+    // warm up the pool
+    for (unsigned int i = 0; i < size; ++i)
+    {
+        m_idle.push_back( Open() );
+    }
+}
+
+Merchant::BankConnectionPool::~BankConnectionPool()
+{
+    for (auto& client : m_idle)
+    {
+        Close( std::move(client) );
+    }
+}
+
+Merchant::BankConnectionPool::Connection Merchant::BankConnectionPool::Acquire()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        while (!m_idle.empty())
+        {
+            std::unique_ptr<::NetComm::Client> client = std::move(m_idle.back());
+            m_idle.pop_back();
+
+            // a connection the bank closed while it sat here, e.g. because the bank
+            // restarted, is dropped instead of failing the command it would be lent for
+            if (!client->Idle())
+            {
+                Log::Info("dropped closed bank connection");
+                continue;
+            }
+
+            return Connection( *this, std::move(client) );
+        }
+    }
+
+    // every warm connection is busy or gone, so open another one
+    return Connection( *this, Open() );
+}
+
+std::unique_ptr<::NetComm::Client> Merchant::BankConnectionPool::Open()
+{
+    std::unique_ptr<::NetComm::Client> client( new ::NetComm::Client(bankHost, bankPort) );
+    client->Connect();
+    return client;
+}
+
+void Merchant::BankConnectionPool::Close( std::unique_ptr<::NetComm::Client> client )
+{
+    try
+    {
+        client->WriteAndWaitForAcknowledge("CLOSE CONNECTION");
+    }
+    catch (std::exception& e)
+    {
+        Log::Warning("exception").Field("in", "Merchant::BankConnectionPool::Close()").Field("error", e.what());
+    }
+}
+
+void Merchant::BankConnectionPool::Return( std::unique_ptr<::NetComm::Client> client )
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_idle.size() < size)
+        {
+            m_idle.push_back( std::move(client) );
+            return;
+        }
+    }
+
+    // the pool is already full, so the extra connection is closed
+    Close( std::move(client) );
+}
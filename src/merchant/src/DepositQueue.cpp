@@ -0,0 +1,297 @@
+// The MIT License (MIT)
+// 
+// Copyright (c) 2015 Jonathan McCluskey and William Harding
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// 
+
+#include "DepositQueue.h"
+#include "Log.h"
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    // wait this long for more deposits before sending a partial batch
+    const std::chrono::milliseconds FLUSH_INTERVAL(100);
+
+    // wait this long before trying again when the bank could not be reached
+    const std::chrono::seconds RETRY_INTERVAL(5);
+
+    const std::string SPOOL_EXTENSION = ".deposit";
+
+    // the spool file holding the first deposit number not handed out yet.  Numbers
+    // are set aside this many at a time, so it is written once per block of deposits.
+    const std::string        SEQUENCE_FILE    = "sequence";
+    const unsigned long long SEQUENCE_RESERVE = 1024;
+
+    Metrics::Counter&   deposits_queued  = Metrics::GetCounter("merchant_deposits_queued_total", "Deposits written to the spool");
+    Metrics::Gauge&     deposits_pending = Metrics::GetGauge("merchant_deposits_pending", "Deposits the bank has not answered for yet");
+    Metrics::Histogram& forward_latency  = Metrics::GetHistogram("merchant_deposit_batch_seconds", "Time to send one deposit batch to the bank and read its receipt");
+    Metrics::Counter&   forward_failures = Metrics::GetCounter("merchant_deposit_batch_failures_total", "Deposit batches that could not be sent");
+
+    // write to a temporary file and rename it, so that a crash never leaves
+    // a half written deposit behind
+    void WriteFileDurably(const std::string& filename, const std::string& data)
+    {
+        std::string tmp_filename = filename + ".tmp";
+
+        int fd = open(tmp_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Unable to create " + tmp_filename);
+        }
+
+        size_t written = 0;
+        while (written < data.size())
+        {
+            ssize_t n = write(fd, data.data() + written, data.size() - written);
+            if (n < 0)
+            {
+                close(fd);
+                throw std::runtime_error("Unable to write " + tmp_filename);
+            }
+            written += n;
+        }
+
+        fsync(fd);
+        close(fd);
+
+        if (rename(tmp_filename.c_str(), filename.c_str()) != 0)
+        {
+            throw std::runtime_error("Unable to rename " + tmp_filename);
+        }
+    }
+
+    std::string ReadFile(const std::string& filename)
+    {
+        std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+        std::stringstream contents;
+        contents << in.rdbuf();
+        return contents.str();
+    }
+}
+
+Merchant::DepositQueue::DepositQueue( BankConnectionPool& bankPool,
+                                      const std::string&  identity,
+                                      const std::string&  spoolDirectory )
+    : bankPool( bankPool ),
+      identity( identity ),
+      spoolDirectory( spoolDirectory )
+{
+    LoadSpool();
+    m_worker = std::thread(&DepositQueue::Worker, this);
+}
+
+Merchant::DepositQueue::~DepositQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+
+    m_cond.notify_all();
+    m_worker.join();
+}
+
+void Merchant::DepositQueue::Enqueue( const Deposit& deposit )
+{
+    unsigned long long sequence;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // the bank takes a number it has seen from this depositor as the same deposit,
+        // so a number is saved as used before any deposit goes out with it
+        if (m_next_sequence >= m_reserved_sequence)
+        {
+            WriteFileDurably(spoolDirectory + "/" + SEQUENCE_FILE, std::to_string(m_next_sequence + SEQUENCE_RESERVE));
+            m_reserved_sequence = m_next_sequence + SEQUENCE_RESERVE;
+        }
+
+        sequence = m_next_sequence++;
+    }
+
+    // zero padded so that the spool is replayed in the order it was written
+    std::stringstream filename;
+    filename << spoolDirectory << "/" << std::setw(20) << std::setfill('0') << sequence << SPOOL_EXTENSION;
+
+    // the spool number goes with the deposit, so a batch sent again is known as such
+    Deposit copy(deposit);
+    copy.m_sequence = sequence;
+    WriteFileDurably(filename.str(), copy.Serialize());
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.push_back( Entry(filename.str(), copy) );
+    }
+
+    deposits_queued.Increment();
+    deposits_pending.Add(1);
+
+    m_cond.notify_one();
+}
+
+void Merchant::DepositQueue::LoadSpool()
+{
+    if (mkdir(spoolDirectory.c_str(), 0700) != 0 && errno != EEXIST)
+    {
+        throw std::runtime_error("Unable to create spool directory " + spoolDirectory);
+    }
+
+    DIR* dir = opendir(spoolDirectory.c_str());
+    if (dir == NULL)
+    {
+        throw std::runtime_error("Unable to open spool directory " + spoolDirectory);
+    }
+
+    std::vector<std::string> names;
+    while (struct dirent* entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if (name.size() > SPOOL_EXTENSION.size() &&
+            name.compare(name.size() - SPOOL_EXTENSION.size(), SPOOL_EXTENSION.size(), SPOOL_EXTENSION) == 0)
+        {
+            names.push_back(name);
+        }
+    }
+    closedir(dir);
+
+    std::sort(names.begin(), names.end());
+
+    for (const auto& name : names)
+    {
+        std::string filename = spoolDirectory + "/" + name;
+
+        Deposit deposit;
+        deposit.Deserialize( ReadFile(filename) );
+        m_pending.push_back( Entry(filename, deposit) );
+
+        m_next_sequence = std::max(m_next_sequence, std::strtoull(name.c_str(), NULL, 10) + 1);
+    }
+
+    // an empty spool says nothing about the numbers already used
+    const std::string saved = ReadFile(spoolDirectory + "/" + SEQUENCE_FILE);
+    m_next_sequence     = std::max(m_next_sequence, std::strtoull(saved.c_str(), NULL, 10));
+    m_reserved_sequence = m_next_sequence;
+
+    deposits_pending.Add(m_pending.size());
+
+    if (!m_pending.empty())
+    {
+        Log::Info("recovered spooled deposits").Field("count", m_pending.size());
+    }
+}
+
+void Merchant::DepositQueue::Worker()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_cond.wait(lock, [this]{ return m_stopping || !m_pending.empty(); });
+
+        // give the batch a moment to fill up
+        m_cond.wait_for(lock, FLUSH_INTERVAL, [this]{ return m_stopping || m_pending.size() >= MAX_BATCH_SIZE; });
+
+        if (m_pending.empty())
+        {
+            break;
+        }
+
+        size_t count = std::min<size_t>(m_pending.size(), MAX_BATCH_SIZE);
+        std::vector<Entry> entries(m_pending.begin(), m_pending.begin() + count);
+
+        lock.unlock();
+        bool forwarded = Forward(entries);
+        lock.lock();
+
+        if (forwarded)
+        {
+            // only the worker removes entries, so these are still the front of the queue
+            m_pending.erase(m_pending.begin(), m_pending.begin() + count);
+            deposits_pending.Add(-static_cast<int64_t>(count));
+        }
+        else if (m_stopping)
+        {
+            // whatever is left is still spooled and will be sent after a restart
+            break;
+        }
+        else
+        {
+            m_cond.wait_for(lock, RETRY_INTERVAL, [this]{ return m_stopping; });
+        }
+    }
+}
+
+bool Merchant::DepositQueue::Forward( const std::vector<Entry>& entries )
+{
+    DepositBatch batch;
+    batch.m_depositor = identity;
+    for (const auto& entry : entries)
+    {
+        batch.m_deposits.push_back(entry.deposit);
+    }
+
+    DepositReceipt receipt;
+    try
+    {
+        Metrics::ScopedTimer timer(forward_latency);
+
+        BankConnectionPool::Connection bankClient = bankPool.Acquire();
+
+        bankClient->WriteAndWaitForAcknowledge("DEPOSIT BATCH");
+        bankClient->WriteFramedAndWaitForAcknowledge( batch.Serialize() );
+        receipt.Deserialize( bankClient->ReadFramedAndAcknowledge() );
+
+        bankClient.Release();
+    }
+    catch (std::exception& e)
+    {
+        // the batch stays queued and is sent again.  A deposit that reached the bank
+        // just before the connection failed comes back under the same number, which
+        // the bank takes as the same deposit.
+        Log::Error("exception").Field("in", "Merchant::DepositQueue::Forward()").Field("error", e.what());
+        forward_failures.Increment();
+        return false;
+    }
+
+    for (size_t i = 0; i < receipt.m_results.size() && i < entries.size(); ++i)
+    {
+        Log::Info("deposit").Field("result", receipt.m_results[i])
+                            .Field("amount", entries[i].deposit.m_coin.m_amount);
+    }
+
+    for (const auto& entry : entries)
+    {
+        std::remove(entry.spoolFile.c_str());
+    }
+
+    return true;
+}
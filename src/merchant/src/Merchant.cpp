@@ -25,7 +25,9 @@
 #include <iostream>
 #include <utility>
 
+#include "Log.h"
 #include "MerchantServer.h"
+#include "MetricsServer.h"
 
 int main(int argc, char* argv[])
 {
@@ -33,26 +35,38 @@ int main(int argc, char* argv[])
     {
         if (argc < 5)
         {
-            std::cerr << "Usage: merchant <port> <bank_host> <bank_port> <identity> <cheat>\n";
+            std::cerr << "Usage: merchant <port> <bank_host> <bank_port> <identity> <cheat> [--metrics-port <n>]\n";
             return 1;
         }
 
         bool cheat = false;
-        if (argc > 5)
+        unsigned short metricsPort = 0;
+        for (int i = 5; i < argc; ++i)
         {
-            std::string cheat_string = argv[5];
-            if (cheat_string == "cheat")
+            std::string option = argv[i];
+            if (option == "cheat")
             {
                 cheat = true;
             }
+            else if (option == "--metrics-port" && i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+            {
+                metricsPort = std::atoi(argv[++i]);
+            }
         }
 
         Merchant::MerchantServer merchantServer( argv[1], argv[2], argv[3], argv[4], cheat );
+
+        if (metricsPort != 0)
+        {
+            Metrics::StartMetricsServer(metricsPort);
+        }
+
         merchantServer.Start();
     }
     catch (std::exception& e)
     {
-        std::cerr << "Exception: " << e.what() << "\n";
+        Log::Error("exception").Field("in", "main()").Field("error", e.what());
+        Log::Flush();
     }
 
     return 0;
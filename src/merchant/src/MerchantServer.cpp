@@ -25,9 +25,14 @@
 #include "MerchantServer.h"
 
 #include "BlindSignature.h"
+#include "Coin.h"
+#include "Log.h"
+#include "Metrics.h"
 #include "MoneyOrder.h"
 #include "MoneyOrderInfo.h"
+#include "PublicKeySet.h"
 #include "Random.h"
+#include "RevealedHalves.h"
 #include "Rsa.h"
 #include "SecretSplitting.h"
 #include "Utilities.h"
@@ -35,123 +40,279 @@
 namespace
 {
     const unsigned int BASE = 10;
+
+    // how long the cached bank key is trusted before the bank's key id is checked again.
+    // The check is one short message, so it can be frequent enough to notice a rotation.
+    const std::chrono::seconds BANK_KEY_MAX_AGE(30);
+
+    // how often a coin the cached keys cannot check may make the merchant ask the bank
+    // for its key id; anyone can send such coins
+    const std::chrono::seconds BANK_KEY_MIN_RECHECK(1);
+
+    // the most identity strings a buyer may ask the merchant to select from
+    const unsigned int MAX_IDENT_STRINGS = 4096;
+
+    Metrics::Histogram& purchase_latency = Metrics::GetHistogram("merchant_purchase_seconds", "Time from a buyer connecting to the money order being queued for deposit");
+
+    const std::string CRYPTO_HELP = "Time taken by one cryptographic operation";
+    Metrics::Histogram& verify_signature_latency = Metrics::GetHistogram("crypto_seconds{op=\"verify_signature\"}", CRYPTO_HELP);
+    // checking the revealed halves of a money order, which is mostly hashing
+    Metrics::Histogram& verify_latency = Metrics::GetHistogram("crypto_seconds{op=\"verify\"}", CRYPTO_HELP);
+
+    const std::string PURCHASE_HELP = "Purchases by outcome";
+    Metrics::Counter& purchases_accepted = Metrics::GetCounter("merchant_purchases_total{result=\"accepted\"}", PURCHASE_HELP);
+    Metrics::Counter& purchases_rejected = Metrics::GetCounter("merchant_purchases_total{result=\"rejected\"}", PURCHASE_HELP);
+
+    // checks the bank's signature on the coin and reads the money order out of it
+    bool DecodeMoneyOrder( const Coin&           coin,
+                           const Rsa::PublicKey& pub,
+                           MoneyOrder&           moneyOrder )
+    {
+        try
+        {
+            {
+                Metrics::ScopedTimer timer(verify_signature_latency);
+                if (!Rsa::VerifyFullDomainHash( coin.m_money_order, mpz_class(coin.m_signature, BASE), pub ))
+                {
+                    return false;
+                }
+            }
+
+            moneyOrder.Deserialize( coin.m_money_order );
+            return true;
+        }
+        catch (std::exception& e)
+        {
+            return false;
+        }
+    }
+}
+
+void Merchant::MerchantServer::OpenAccount()
+{
+    BankConnectionPool::Connection bankClient = m_bank_pool.Acquire();
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    // Send bank open account commend
+    bankClient->WriteAndWaitForAcknowledge("OPEN ACCOUNT");
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    // Send identity and initial account amount to bank
+    bankClient->WriteAndWaitForAcknowledge( identity );
+    bankClient->WriteAndWaitForAcknowledge( std::to_string( 0 ) );
+
+    bankClient.Release();
+}
+
+bool Merchant::MerchantServer::BankKey( const unsigned int epoch, const unsigned int amount, Rsa::PublicKey& pub )
+{
+    bool stale;
+    {
+        std::lock_guard<std::mutex> lock(m_bank_key_mutex);
+        stale = (std::chrono::steady_clock::now() - m_bank_key_time >= BANK_KEY_MAX_AGE);
+    }
+
+    if (stale)
+    {
+        CheckBankKey();
+    }
+
+    std::lock_guard<std::mutex> lock(m_bank_key_mutex);
+    auto key = m_bank_keys.find(PublicKeySet::KeyId(epoch, amount));
+    if (key == m_bank_keys.end())
+    {
+        return false;
+    }
+
+    pub = key->second;
+    return true;
+}
+
+void Merchant::MerchantServer::CheckBankKey()
+{
+    BankConnectionPool::Connection bankClient = m_bank_pool.Acquire();
+
+    bankClient->WriteAndWaitForAcknowledge("GET KEY ID");
+    std::string keyId = bankClient->ReadAndAcknowledge();
+    bankClient.Release();
+
+    {
+        std::lock_guard<std::mutex> lock(m_bank_key_mutex);
+        if (keyId == m_bank_key_id)
+        {
+            // nothing new, the cached keys are good for another while
+            m_bank_key_time = std::chrono::steady_clock::now();
+            return;
+        }
+    }
+
+    RefreshBankKey();
+}
+
+void Merchant::MerchantServer::RecheckBankKey()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_bank_key_mutex);
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - m_bank_key_recheck_time < BANK_KEY_MIN_RECHECK)
+        {
+            return;
+        }
+        m_bank_key_recheck_time = now;
+    }
+
+    CheckBankKey();
+}
+
+void Merchant::MerchantServer::RefreshBankKey()
+{
+    BankConnectionPool::Connection bankClient = m_bank_pool.Acquire();
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    // Send bank key commend
+    bankClient->WriteAndWaitForAcknowledge("GET PUBLIC KEY");
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    // Get Bank's Keys, one per denomination and epoch it still takes
+    std::string serialized = bankClient->ReadFramedAndAcknowledge();
+    bankClient.Release();
+
+    PublicKeySet keySet;
+    keySet.Deserialize( serialized );
+
+    std::map<PublicKeySet::KeyId, Rsa::PublicKey> bankKeys;
+    for (const auto& key : keySet.m_keys)
+    {
+        bankKeys[key.first] = Rsa::PublicKey((mpz_class(key.second.first, BASE)), (mpz_class(key.second.second, BASE)));
+    }
+
+    std::lock_guard<std::mutex> lock(m_bank_key_mutex);
+    m_bank_keys.swap(bankKeys);
+    m_bank_key_id = PublicKeySet::Fingerprint(serialized);
+    m_bank_key_time = std::chrono::steady_clock::now();
 }
 
 void Merchant::MerchantServer::run(tcp::socket sock1)
 {
+    Metrics::ScopedTimer timer(purchase_latency);
+
     try
     {
-        //////////////////////////////////////////////////////////////////////////////////////////
-        // Connect
-        ::NetComm::Client bankClient(bankHost, bankPort);
-        bankClient.Connect();
-
-        //////////////////////////////////////////////////////////////////////////////////////////
-        // Send bank open account commend
-        bankClient.WriteAndWaitForAcknowledge("OPEN ACCOUNT");
-
-        //////////////////////////////////////////////////////////////////////////////////////////
-        // Send identity and initial account amount to bank
-        bankClient.WriteAndWaitForAcknowledge( identity );
-        bankClient.WriteAndWaitForAcknowledge( std::to_string( 0 ) );
-
-        //////////////////////////////////////////////////////////////////////////////////////////
-        // Send bank key commend
-        bankClient.WriteAndWaitForAcknowledge("GET PUBLIC KEY");
-
-        //////////////////////////////////////////////////////////////////////////////////////////
-        // Get Bank's Key
-        std::string bank_key = bankClient.ReadAndAcknowledge();
-        std::string bank_mod = bankClient.ReadAndAcknowledge();
-        Rsa::PublicKey pub((mpz_class(bank_mod, BASE)), (mpz_class(bank_key, BASE)));
-
-        // Wait to get a money order for my awesome item
-        std::string BuyersMoneyOrderStr = ReadAndAcknowledge(sock1);
-        mpz_class BuyersMoneyOrder(BuyersMoneyOrderStr);
-        mpz_class UnsignedBuyersMoneyOrder = Rsa::Unsign( BuyersMoneyOrder, pub, true );
-        MoneyOrder moneyOrder;
-        moneyOrder.Deserialize( Utilities::NumberToString(UnsignedBuyersMoneyOrder) );
+        // Wait to get a coin for my awesome item
+        Coin coin;
+        coin.Deserialize( ReadFramedAndAcknowledge(sock1) );
+
+        // The coin is worth the denomination whose key signed it
+        const unsigned int amount = coin.m_amount;
+        const unsigned int epoch  = coin.m_epoch;
+        Rsa::PublicKey pub;
+        if (!BankKey(epoch, amount, pub))
+        {
+            // the bank may have added the denomination, or rotated its keys, since
+            // we cached them
+            RecheckBankKey();
+            if (!BankKey(epoch, amount, pub))
+            {
+                Log::Warning("unknown denomination").Field("amount", amount).Field("epoch", epoch);
+                return;
+            }
+        }
 
         // Verify L's and R's on MoneyOrder
         //    - Create a string of 1's and 2's (where Left=1 and Right=2)
         //    - Write it to the Buyer
-        //    - For each response
-        //      -- Wait for the buyer's response
-        //      -- Verify the results
+        //    - Wait for the buyer's responses
+        //    - Verify the results
+        unsigned int num_ident_strings = std::atoi(ReadAndAcknowledge(sock1).c_str());
+        if (num_ident_strings == 0 || num_ident_strings > MAX_IDENT_STRINGS)
+        {
+            Log::Warning("bad identity string count").Field("count", num_ident_strings);
+            return;
+        }
 
-        // Create the string of 1's and 2's
-        std::stringstream x;
-        for(unsigned int i = 0; i < moneyOrder.m_identity_strings.size(); ++i)
+        // Create the string of 1's and 2's, one bit of /dev/urandom each: two spends of a
+        // coin must get different selectors for the bank to name the buyer
+        const std::string bits = Random::GenerateRandomBytes((num_ident_strings + 7) / 8);
+        std::string x;
+        for(unsigned int i = 0; i < num_ident_strings; ++i)
         {
-            x << Random::GenerateRandomNumberRange(2).get_str();
+            x += ((static_cast<unsigned char>(bits[i / 8]) >> (i % 8)) & 1) ? '1' : '2';
         }
 
         // Write it to the Buyer
-        WriteAndWaitForAcknowledge(sock1, x.str());
+        WriteAndWaitForAcknowledge(sock1, x);
 
-        bool verified = true;
+        // Wait for the buyer's responses
+        RevealedHalves revealed;
+        revealed.Deserialize( ReadFramedAndAcknowledge(sock1) );
 
-        std::vector<std::string> buyersResponses;
-        for(unsigned int i = 0; i < moneyOrder.m_identity_strings.size(); ++i)
+        // a single exponentiation with the public exponent, however long the money order
+        MoneyOrder moneyOrder;
+        if (!DecodeMoneyOrder( coin, pub, moneyOrder ))
         {
-            // Wait for the buyer's response
-            std::string buyersResponse = ReadAndAcknowledge( sock1 );
-            buyersResponses.push_back( buyersResponse );
-            CommitData c;
-            c.Deserialize( buyersResponse );
-            
-            if (x.str()[i] == '1')
+            // the bank may have changed its key since we cached it
+            RecheckBankKey();
+            if (!BankKey( epoch, amount, pub ) || !DecodeMoneyOrder( coin, pub, moneyOrder ))
             {
-                verified &= Verify(c, moneyOrder.m_identity_strings[i].first.first,
-                                      moneyOrder.m_identity_strings[i].first.second);
-            }
-            else
-            {
-                verified &= Verify(c, moneyOrder.m_identity_strings[i].second.first,
-                                      moneyOrder.m_identity_strings[i].second.second);
+                Log::Warning("money order not signed by the bank").Field("amount", amount);
+                return;
             }
         }
-       
+
+        bool verified = (moneyOrder.m_identity_strings.size() == num_ident_strings) &&
+                        (revealed.m_commit_data.size() == num_ident_strings);
+
         if (verified)
         {
-            bankClient.WriteAndWaitForAcknowledge("DEPOSIT MONEY ORDER");
-            bankClient.WriteAndWaitForAcknowledge( identity );
-            bankClient.WriteAndWaitForAcknowledge( BuyersMoneyOrderStr );
-            bankClient.WriteAndWaitForAcknowledge( x.str() );
-            for(unsigned int i = 0; i < moneyOrder.m_identity_strings.size(); ++i)
+            std::vector<CommitData> commitData(num_ident_strings);
+            std::vector<CommitPair> originals;
+            for(unsigned int i = 0; i < num_ident_strings; ++i)
             {
-                bankClient.WriteAndWaitForAcknowledge( buyersResponses[i] );
+                commitData[i].Deserialize( revealed.m_commit_data[i] );
+
+                if (x[i] == '1')
+                {
+                    originals.push_back( moneyOrder.m_identity_strings[i].first );
+                }
+                else
+                {
+                    originals.push_back( moneyOrder.m_identity_strings[i].second );
+                }
             }
 
-            std::string bank_response = bankClient.ReadAndAcknowledge();
-            std::cout << bank_response << std::endl;
+            Metrics::ScopedTimer timer(verify_latency);
+            verified = VerifyBatch( commitData, originals );
+        }
+
+        const std::vector<std::string>& buyersResponses = revealed.m_commit_data;
+       
+        if (verified)
+        {
+            // the deposit queue forwards it to the bank, the buyer does not wait for that
+            Deposit deposit;
+            deposit.m_coin        = coin;
+            deposit.m_selector    = x;
+            deposit.m_commit_data = buyersResponses;
+            m_deposit_queue.Enqueue( deposit );
 
             // if the merchant is trying to cheat, deposit money order twice
             if (cheat)
             {
-                bankClient.WriteAndWaitForAcknowledge("DEPOSIT MONEY ORDER");
-                bankClient.WriteAndWaitForAcknowledge( identity );
-                bankClient.WriteAndWaitForAcknowledge( BuyersMoneyOrderStr );
-                bankClient.WriteAndWaitForAcknowledge( x.str() );
-                for(unsigned int i = 0; i < moneyOrder.m_identity_strings.size(); ++i)
-                {
-                    bankClient.WriteAndWaitForAcknowledge( buyersResponses[i] );
-                }
-
-                std::string bank_response = bankClient.ReadAndAcknowledge();
-                std::cout << bank_response << std::endl;
+                m_deposit_queue.Enqueue( deposit );
             }
+
+            purchases_accepted.Increment();
         }
         else
         {
-            std::cout << "Buyer verification failed!!! WITCW!" << std::endl;
+            purchases_rejected.Increment();
+            Log::Warning("buyer verification failed");
         }
-
-        bankClient.WriteAndWaitForAcknowledge("CLOSE CONNECTION");
     }
     catch (std::exception& e)
     {
-        std::cerr << "Exception in thread: " << e.what() << "\n";
+        Log::Error("exception").Field("in", "Merchant::MerchantServer::run()").Field("error", e.what());
     }
 }
 